@@ -0,0 +1,57 @@
+#ifndef AISDI_MAPS_EBOSTORAGE_H
+#define AISDI_MAPS_EBOSTORAGE_H
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace aisdi
+{
+
+namespace detail
+{
+
+// Holds a functor (hash, comparator) as a base class when it is empty, so stateless ones take no space.
+// 'Index' keeps two storages of the same functor type apart.
+template <typename T, std::size_t Index, bool = std::is_empty<T>::value>
+class EboStorage : private T
+{
+public:
+    explicit EboStorage( const T& value ) : T(value) {}
+
+    T& get()
+    {
+        return *this;
+    }
+
+    const T& get() const
+    {
+        return *this;
+    }
+};
+
+template <typename T, std::size_t Index>
+class EboStorage<T, Index, false>
+{
+public:
+    explicit EboStorage( const T& value ) : value(value) {}
+
+    T& get()
+    {
+        return value;
+    }
+
+    const T& get() const
+    {
+        return value;
+    }
+
+private:
+    T value;
+};
+
+}
+
+}
+
+#endif /* AISDI_MAPS_EBOSTORAGE_H */
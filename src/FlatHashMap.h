@@ -0,0 +1,627 @@
+#ifndef AISDI_MAPS_FLATHASHMAP_H
+#define AISDI_MAPS_FLATHASHMAP_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include <functional>
+
+namespace aisdi
+{
+
+// Open addressing hash map with Robin Hood probing.
+// Elements are stored inline in one slot array, next to it there is an array
+// of probe distances (0 - empty slot, d - element lies d-1 slots past its home).
+// Adding or removing an element moves its neighbours, so both invalidate all iterators.
+template <typename KeyType, typename ValueType>
+class FlatHashMap
+{
+public:
+    using key_type = KeyType;
+    using mapped_type = ValueType;
+    using value_type = std::pair<const key_type, mapped_type>;
+    using size_type = std::size_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+
+    class ConstIterator;
+    class Iterator;
+    using iterator = Iterator;
+    using const_iterator = ConstIterator;
+
+public:
+    FlatHashMap( size_type tableSize = 16 )
+    : slots(nullptr), distances(nullptr), capacity(0), shift(0), origin(0), number_of_elements(0), max_load(0.875f)
+    {
+        allocate( roundCapacity( tableSize ) );
+    }
+
+    FlatHashMap( std::initializer_list<value_type> list ) : FlatHashMap()
+    {
+        reserve( list.size() );
+        for( auto it = list.begin(); it != list.end(); ++it )
+            (*this)[(*it).first] = (*it).second;
+    }
+
+    FlatHashMap( const FlatHashMap& other ) : FlatHashMap( 0 )
+    {
+        *this = other;
+    }
+
+    FlatHashMap( FlatHashMap&& other )
+    : slots(other.slots), distances(other.distances), capacity(other.capacity), shift(other.shift),
+      origin(other.origin), number_of_elements(other.number_of_elements), max_load(other.max_load)
+    {
+        other.slots = nullptr;
+        other.distances = nullptr;
+        other.capacity = 0;
+        other.number_of_elements = 0;
+    }
+
+    ~FlatHashMap()
+    {
+        deleteAll();
+        deallocate( slots, distances );
+    }
+
+    FlatHashMap& operator=( const FlatHashMap& other )
+    {
+        if( this != &other )
+        {
+            deleteAll();
+            max_load = other.max_load;
+
+            if( capacity != other.capacity )
+            {
+                deallocate( slots, distances );
+                slots = nullptr;
+                distances = nullptr;
+                capacity = 0;
+                allocate( other.capacity );
+            }
+
+            // A moved-from 'other' has no table, this map keeps an empty one of its own
+            if( capacity != other.capacity )
+                return *this;
+
+            // Same capacity and hash, so every element lands in the same slot
+            origin = other.origin;
+            for( size_type i = 0; i < capacity; ++i )
+            {
+                if( other.distances[i] != 0 )
+                {
+                    new (slots + i) value_type( other.slots[i] );
+                    distances[i] = other.distances[i];
+                    ++number_of_elements;
+                }
+            }
+        }
+        return *this;
+    }
+
+    FlatHashMap& operator=( FlatHashMap&& other )
+    {
+        if( this != &other )
+        {
+            deleteAll();
+            deallocate( slots, distances );
+
+            slots = other.slots;
+            distances = other.distances;
+            capacity = other.capacity;
+            shift = other.shift;
+            origin = other.origin;
+            number_of_elements = other.number_of_elements;
+            max_load = other.max_load;
+
+            other.slots = nullptr;
+            other.distances = nullptr;
+            other.capacity = 0;
+            other.number_of_elements = 0;
+        }
+        return *this;
+    }
+
+    bool isEmpty() const
+    {
+        return (number_of_elements == 0);
+    }
+
+    mapped_type& operator[]( const key_type& key )
+    {
+        size_type index = findIndex( key );
+        if( index != capacity )
+            return slots[index].second;
+
+        if( number_of_elements + 1 > capacity * max_load )
+            rehash( 2 * capacity );
+
+        return slots[ insertValue( value_type( key, mapped_type() ) ) ].second;
+    }
+
+    const mapped_type& valueOf( const key_type& key ) const
+    {
+        size_type index = findIndex( key );
+        if( index == capacity )
+            throw std::out_of_range("valueOf");
+        return slots[index].second;
+    }
+
+    mapped_type& valueOf( const key_type& key )
+    {
+        size_type index = findIndex( key );
+        if( index == capacity )
+            throw std::out_of_range("valueOf");
+        return slots[index].second;
+    }
+
+    const_iterator find( const key_type& key ) const
+    {
+        return const_iterator( this, findIndex( key ) );
+    }
+
+    iterator find( const key_type& key )
+    {
+        return iterator( this, findIndex( key ) );
+    }
+
+    void remove( const key_type& key )
+    {
+        remove( find( key ) );
+    }
+
+    // Returns the element that followed the removed one. Backward shift may have pulled it
+    // into the freed slot, so a copy of 'it' advanced before the call could skip it.
+    iterator remove( const const_iterator& it )
+    {
+        if( this != it.base_map || it == end() )
+            throw std::out_of_range("remove");
+        eraseIndex( it.index );
+
+        if( distances[it.index] != 0 )
+            return iterator( this, it.index );
+        return iterator( this, following( it.index ) );
+    }
+
+    size_type getSize() const
+    {
+        return number_of_elements;
+    }
+
+    bool operator==( const FlatHashMap& other ) const
+    {
+        if( number_of_elements != other.number_of_elements )
+            return false;
+
+        for( auto it = begin(); it != end(); ++it )
+        {
+            size_type index = other.findIndex( it->first );
+            if( index == other.capacity || other.slots[index].second != it->second )
+                return false;
+        }
+        return true;
+    }
+
+    bool operator!=( const FlatHashMap& other ) const
+    {
+        return !(*this == other);
+    }
+
+    iterator begin()
+    {
+        return iterator( this, following( origin ) );
+    }
+
+    iterator end()
+    {
+        return iterator( this, capacity );
+    }
+
+    const_iterator cbegin() const
+    {
+        return const_iterator( this, following( origin ) );
+    }
+
+    const_iterator cend() const
+    {
+        return const_iterator( this, capacity );
+    }
+
+    const_iterator begin() const
+    {
+        return cbegin();
+    }
+
+    const_iterator end() const
+    {
+        return cend();
+    }
+
+    size_type bucket_count() const
+    {
+        return capacity;
+    }
+
+    float load_factor() const
+    {
+        if( capacity == 0 )
+            return 0.0f;
+        return static_cast<float>( number_of_elements ) / capacity;
+    }
+
+    float max_load_factor() const
+    {
+        return max_load;
+    }
+
+    // Open addressing needs at least one empty slot, hence the upper bound
+    void max_load_factor( float ml )
+    {
+        if( !( ml > 0.0f && ml < 1.0f ) )
+            throw std::invalid_argument("max_load_factor");
+        max_load = ml;
+
+        if( load_factor() > max_load )
+            rehash( 0 );
+    }
+
+    // Capacity is always a power of two and never below what max_load_factor() allows
+    void rehash( size_type count )
+    {
+        size_type minimal = static_cast<size_type>( std::ceil( number_of_elements / max_load ) ) + 1;
+        size_type new_capacity = roundCapacity( count > minimal ? count : minimal );
+        if( new_capacity == capacity )
+            return;
+
+        value_type *old_slots = slots;
+        distance_type *old_distances = distances;
+        size_type old_capacity = capacity;
+
+        allocate( new_capacity );
+        number_of_elements = 0;
+
+        for( size_type i = 0; i < old_capacity; ++i )
+        {
+            if( old_distances[i] != 0 )
+            {
+                insertValue( std::move( old_slots[i] ) );
+                old_slots[i].~value_type();
+            }
+        }
+
+        deallocate( old_slots, old_distances );
+    }
+
+    void reserve( size_type count )
+    {
+        if( count > capacity * max_load )
+            rehash( static_cast<size_type>( std::ceil( count / max_load ) ) );
+    }
+
+private:
+    // A distance never exceeds the capacity, which allocate() keeps within this type
+    using distance_type = std::uint32_t;
+
+    value_type *slots;
+    distance_type *distances;
+    size_type capacity;
+    unsigned shift;
+    // An empty slot iteration starts after and wraps around to. No run of elements crosses it,
+    // so backward shift only moves elements towards the current iterator, never behind it.
+    size_type origin;
+    size_type number_of_elements;
+    float max_load;
+
+    static size_type roundCapacity( size_type count )
+    {
+        size_type result = 8;
+        while( result < count )
+            result *= 2;
+        return result;
+    }
+
+    // Rounded up like every table size - a table of 0 or 1 slots would shift hashes by 64
+    void allocate( size_type count )
+    {
+        count = roundCapacity( count );
+        if( count > ( size_type(1) << 31 ) )
+            throw std::length_error("FlatHashMap");
+
+        value_type *new_slots = static_cast<value_type*>( ::operator new( count * sizeof(value_type) ) );
+        try
+        {
+            distances = new distance_type [count]();
+        }
+        catch( ... )
+        {
+            ::operator delete( new_slots );
+            throw;
+        }
+        slots = new_slots;
+        capacity = count;
+        origin = count - 1;
+
+        shift = 64;
+        for( size_type i = count; i > 1; i /= 2 )
+            --shift;
+    }
+
+    static void deallocate( value_type *slots, distance_type *distances )
+    {
+        ::operator delete( slots );
+        delete[] distances;
+    }
+
+    void deleteAll()
+    {
+        for( size_type i = 0; i < capacity && number_of_elements > 0; ++i )
+        {
+            if( distances[i] != 0 )
+            {
+                slots[i].~value_type();
+                distances[i] = 0;
+                --number_of_elements;
+            }
+        }
+    }
+
+    // Fibonacci hashing - the top bits of the product pick the home slot,
+    // so that identity hashes of sequential keys do not form one long run
+    size_type homeOf( const key_type& key ) const
+    {
+        std::uint64_t hash = std::hash<key_type>()( key );
+        return static_cast<size_type>( ( hash * 0x9E3779B97F4A7C15ull ) >> shift );
+    }
+
+    size_type findIndex( const key_type& key ) const
+    {
+        if( number_of_elements == 0 )
+            return capacity;
+
+        size_type index = homeOf( key );
+        for( unsigned distance = 1; distances[index] >= distance; ++distance )
+        {
+            // Only an element with the same home can hold the key
+            if( distances[index] == distance && slots[index].first == key )
+                return index;
+
+            index = ( index + 1 ) & ( capacity - 1 );
+        }
+        return capacity;
+    }
+
+    // Key of 'value' must not be in the map yet and there must be an empty slot.
+    // Never fails, so rehash() cannot be left with half of the elements moved.
+    size_type insertValue( value_type&& value )
+    {
+        size_type index = homeOf( value.first );
+        distance_type distance = 1;
+
+        // Robin Hood: stop at the first element that is closer to its home than we are
+        while( distances[index] >= distance )
+        {
+            index = ( index + 1 ) & ( capacity - 1 );
+            ++distance;
+        }
+
+        // Elements from 'index' up to the first empty slot move one slot further
+        size_type empty = index;
+        while( distances[empty] != 0 )
+            empty = ( empty + 1 ) & ( capacity - 1 );
+
+        if( empty == origin )
+        {
+            // Load is below 1, so there is another empty slot further on
+            do
+                origin = ( origin + 1 ) & ( capacity - 1 );
+            while( distances[origin] != 0 || origin == empty );
+        }
+
+        while( empty != index )
+        {
+            size_type prev = ( empty - 1 ) & ( capacity - 1 );
+            new (slots + empty) value_type( std::move( slots[prev] ) );
+            slots[prev].~value_type();
+            distances[empty] = distances[prev] + 1;
+            empty = prev;
+        }
+
+        new (slots + index) value_type( std::move( value ) );
+        distances[index] = distance;
+        ++number_of_elements;
+        return index;
+    }
+
+    // Backward shift deletion - following elements are pulled one slot closer to home
+    void eraseIndex( size_type index )
+    {
+        slots[index].~value_type();
+
+        size_type next = ( index + 1 ) & ( capacity - 1 );
+        while( distances[next] > 1 )
+        {
+            new (slots + index) value_type( std::move( slots[next] ) );
+            slots[next].~value_type();
+            distances[index] = distances[next] - 1;
+
+            index = next;
+            next = ( next + 1 ) & ( capacity - 1 );
+        }
+
+        distances[index] = 0;
+        --number_of_elements;
+    }
+
+    // Next element after slot 'index' in iteration order, capacity if there is none
+    size_type following( size_type index ) const
+    {
+        if( capacity == 0 )
+            return 0;
+
+        do
+        {
+            index = ( index + 1 ) & ( capacity - 1 );
+            if( index == origin )
+                return capacity;
+        }
+        while( distances[index] == 0 );
+        return index;
+    }
+
+    // Previous element before slot 'index' (or before end() for capacity), capacity if there is none
+    size_type preceding( size_type index ) const
+    {
+        if( capacity == 0 )
+            return 0;
+
+        if( index == capacity )
+            index = origin;
+        do
+        {
+            index = ( index - 1 ) & ( capacity - 1 );
+            if( index == origin )
+                return capacity;
+        }
+        while( distances[index] == 0 );
+        return index;
+    }
+};
+
+template <typename KeyType, typename ValueType>
+class FlatHashMap<KeyType, ValueType>::ConstIterator
+{
+    const FlatHashMap *base_map;
+    size_type index;
+    friend class FlatHashMap;
+
+public:
+    using reference = typename FlatHashMap::const_reference;
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = typename FlatHashMap::value_type;
+    using pointer = const typename FlatHashMap::value_type*;
+
+    explicit ConstIterator( const FlatHashMap *base_map = nullptr, size_type index = 0 ) : base_map(base_map), index(index)
+    {}
+
+    ConstIterator( const ConstIterator& other ) : ConstIterator(other.base_map, other.index)
+    {}
+
+    ConstIterator& operator++()
+    {
+        if( base_map == nullptr || index >= base_map->capacity )
+            throw std::out_of_range("operator++");
+
+        index = base_map->following( index );
+        return *this;
+    }
+
+    ConstIterator operator++(int)
+    {
+        auto result = *this;
+        ++(*this);
+        return result;
+    }
+
+    ConstIterator& operator--()
+    {
+        if( base_map == nullptr )
+            throw std::out_of_range("operator--");
+
+        size_type previous = base_map->preceding( index );
+        if( previous == base_map->capacity )
+            throw std::out_of_range("operator--");
+
+        index = previous;
+        return *this;
+    }
+
+    ConstIterator operator--(int)
+    {
+        auto result = *this;
+        --(*this);
+        return result;
+    }
+
+    reference operator*() const
+    {
+        if( base_map == nullptr || index >= base_map->capacity )
+            throw std::out_of_range("operator*");
+        return base_map->slots[index];
+    }
+
+    pointer operator->() const
+    {
+        return &this->operator*();
+    }
+
+    bool operator==( const ConstIterator& other ) const
+    {
+        return base_map == other.base_map && index == other.index;
+    }
+
+    bool operator!=( const ConstIterator& other ) const
+    {
+        return !(*this == other);
+    }
+};
+
+template <typename KeyType, typename ValueType>
+class FlatHashMap<KeyType, ValueType>::Iterator : public FlatHashMap<KeyType, ValueType>::ConstIterator
+{
+public:
+  using reference = typename FlatHashMap::reference;
+  using pointer = typename FlatHashMap::value_type*;
+
+  explicit Iterator(FlatHashMap *myMap = nullptr, size_type index = 0) : ConstIterator(myMap, index)
+  {}
+
+  Iterator(const ConstIterator& other)
+    : ConstIterator(other)
+  {}
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  reference operator*() const
+  {
+    // ugly cast, yet reduces code duplication.
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_FLATHASHMAP_H */
@@ -1,20 +1,170 @@
 #ifndef AISDI_MAPS_HASHMAP_H
 #define AISDI_MAPS_HASHMAP_H
 
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <initializer_list>
+#include <memory>
 #include <stdexcept>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 
 #include <iostream>
 
 #include <functional>
 
+#include "EboStorage.h"
+#include "NodePool.h"
+#include "Prefetch.h"
+#include "Transparent.h"
+
 namespace aisdi
 {
 
-template <typename KeyType, typename ValueType>
-class HashMap
+// Tells HashMap whether nodes should keep the full hash of their key.
+// With a cached hash most mismatching nodes are rejected without comparing keys
+// and rehashing does not call the hash function again.
+// Keys that are cheap to hash and compare are not cached by default, specialize to change it.
+template <typename KeyType>
+struct CacheHashCode
+: std::integral_constant<bool, !std::is_arithmetic<KeyType>::value && !std::is_enum<KeyType>::value
+                               && !std::is_pointer<KeyType>::value>
+{};
+
+// Bucket policies map a hash to one of 'count' buckets.
+// bucketCount() adjusts a requested table size to one the policy can index.
+
+// Any table size, bucket is the hash modulo the size
+struct ModuloBuckets
+{
+    static std::size_t bucketCount( std::size_t requested )
+    {
+        return requested > 0 ? requested : 1;
+    }
+
+    static std::size_t index( std::size_t hash, std::size_t count )
+    {
+        return hash % count;
+    }
+};
+
+// Power-of-two table sizes indexed by a mask. Hash is mixed first,
+// otherwise identity hashes (std::hash<int>) of strided keys would share low bits.
+struct PowerOfTwoBuckets
+{
+    static std::size_t bucketCount( std::size_t requested )
+    {
+        std::size_t count = 1;
+        while( count < requested )
+            count *= 2;
+        return count;
+    }
+
+    static std::size_t index( std::size_t hash, std::size_t count )
+    {
+        return static_cast<std::size_t>( mix(hash) ) & (count - 1);
+    }
+
+    // Multiply-xorshift finalizer, spreads every input bit over the low bits
+    static std::uint64_t mix( std::uint64_t x )
+    {
+        x ^= x >> 32;
+        x *= UINT64_C(0xd6e8feb86659fd93);
+        x ^= x >> 32;
+        x *= UINT64_C(0xd6e8feb86659fd93);
+        x ^= x >> 32;
+        return x;
+    }
+};
+
+namespace detail
+{
+
+template <bool Cached>
+struct HashCode
+{
+    std::size_t hash_code;
+
+    explicit HashCode( std::size_t hash ) : hash_code(hash) {}
+
+    void storeHash( std::size_t hash )
+    {
+        hash_code = hash;
+    }
+
+    bool mayMatch( std::size_t hash ) const
+    {
+        return hash_code == hash;
+    }
+};
+
+// Takes no space in the node (empty base)
+template <>
+struct HashCode<false>
+{
+    explicit HashCode( std::size_t ) {}
+
+    void storeHash( std::size_t ) {}
+
+    bool mayMatch( std::size_t ) const
+    {
+        return true;
+    }
+};
+
+// Links of the list of all nodes in insertion order, nothing when the map is not ordered
+template <typename Node, bool Linked>
+struct ListLinks
+{
+    Node *before;
+    Node *after;
+
+    ListLinks() : before(nullptr), after(nullptr) {}
+};
+
+template <typename Node>
+struct ListLinks<Node, false>
+{};
+
+// Index of the lowest / highest set bit, 'word' must not be 0
+inline std::size_t lowestBit( std::uint64_t word )
+{
+#if defined(__GNUC__)
+    return static_cast<std::size_t>( __builtin_ctzll( word ) );
+#else
+    std::size_t index = 0;
+    for( ; ( word & 1 ) == 0; word >>= 1 )
+        ++index;
+    return index;
+#endif
+}
+
+inline std::size_t highestBit( std::uint64_t word )
+{
+#if defined(__GNUC__)
+    return 63 - static_cast<std::size_t>( __builtin_clzll( word ) );
+#else
+    std::size_t index = 63;
+    for( ; ( word >> 63 ) == 0; word <<= 1 )
+        --index;
+    return index;
+#endif
+}
+
+}
+
+// Hash and KeyEqual are kept as (empty) bases, stateless functors cost no space.
+// With InsertionOrdered all nodes are also kept on a list in insertion order (see LinkedHashMap):
+// iteration follows it and copying or clearing walks it, whatever the number of buckets.
+template <typename KeyType, typename ValueType,
+          typename Hash = std::hash<KeyType>,
+          typename KeyEqual = std::equal_to<KeyType>,
+          typename Allocator = std::allocator<std::pair<const KeyType, ValueType>>,
+          typename BucketPolicy = ModuloBuckets,
+          bool InsertionOrdered = false>
+class HashMap : private detail::EboStorage<Hash, 0>, private detail::EboStorage<KeyEqual, 1>
 {
 public:
     using key_type = KeyType;
@@ -23,6 +173,9 @@ public:
     using size_type = std::size_t;
     using reference = value_type&;
     using const_reference = const value_type&;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using allocator_type = Allocator;
 
     class ConstIterator;
     class Iterator;
@@ -30,35 +183,55 @@ public:
     using const_iterator = ConstIterator;
 
 public:
-    HashMap( size_type tableSize = 1000 ) : size_of_table(tableSize), table(nullptr), number_of_elements(0)
+    HashMap( size_type tableSize = 1000, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual(),
+             const Allocator& alloc = Allocator() )
+    : HashStorage(hash), EqualStorage(equal),
+      size_of_table( BucketPolicy::bucketCount(tableSize) ), table(nullptr), number_of_elements(0), max_load(1.0f),
+      old_table(nullptr), size_of_old_table(0), migrate_index(0), incremental(false), migration_step(8),
+      first_node(nullptr), last_node(nullptr), pool( NodeAllocator(alloc) )
     {
-        table = new HashNode* [size_of_table];
-        for( size_type i = 0; i < size_of_table; ++i )
-            table[i] = nullptr;
+        table = allocateTable( size_of_table );
     }
 
-    HashMap( std::initializer_list<value_type> list ) : HashMap( list.size() ) // HashMap()
+    HashMap( size_type tableSize, const Allocator& alloc ) : HashMap( tableSize, Hash(), KeyEqual(), alloc )
+    {}
+
+    explicit HashMap( const Allocator& alloc ) : HashMap( 1000, alloc )
+    {}
+
+    HashMap( std::initializer_list<value_type> list, const Allocator& alloc = Allocator() ) : HashMap( list.size(), alloc ) // HashMap()
     {
         for( auto it = list.begin(); it != list.end(); ++it )
-            (*this)[(*it).first] = (*it).second;
+            insert_or_assign( it->first, it->second );
     }
 
-    HashMap( const HashMap& other ) : HashMap( other.size_of_table )
+    HashMap( const HashMap& other )
+    : HashMap( other.size_of_table, other.hashStorage(), other.equalStorage(),
+               std::allocator_traits<Allocator>::select_on_container_copy_construction( other.get_allocator() ) )
     {
         *this = other;
     }
 
-    HashMap( HashMap&& other ) : size_of_table( other.size_of_table ), table(other.table), number_of_elements(other.number_of_elements)
+    HashMap( HashMap&& other )
+    : HashStorage( other.hashStorage() ), EqualStorage( other.equalStorage() ), size_of_table( other.size_of_table ), table(other.table), number_of_elements(other.number_of_elements), max_load(other.max_load),
+      old_table(other.old_table), size_of_old_table(other.size_of_old_table), migrate_index(other.migrate_index),
+      incremental(other.incremental), migration_step(other.migration_step),
+      first_node(other.first_node), last_node(other.last_node), pool( std::move(other.pool) )
     {
         other.size_of_table = 0;
         other.table = nullptr;
         other.number_of_elements = 0;
+        other.old_table = nullptr;
+        other.size_of_old_table = 0;
+        other.migrate_index = 0;
+        other.first_node = nullptr;
+        other.last_node = nullptr;
     }
 
     ~HashMap()
     {
         deleteAll();
-        delete[] table;
+        deallocateTable( table, size_of_table );
     }
 
     HashMap& operator=( const HashMap& other )
@@ -66,8 +239,23 @@ public:
         if( this != &other )
         {
             deleteAll();
-            for( auto it = other.begin(); it != other.end(); ++it )
-                (*this)[(*it).first] = (*it).second;
+
+            if( AllocatorTraits::propagate_on_container_copy_assignment::value && pool.get_allocator() != other.pool.get_allocator() )
+            {
+                // Everything allocated so far has to go back to the old allocator
+                deallocateTable( table, size_of_table );
+                table = nullptr;
+                pool = Pool( other.pool.get_allocator() );
+                table = allocateTable( size_of_table );
+            }
+
+            hashStorage() = other.hashStorage();
+            equalStorage() = other.equalStorage();
+            max_load = other.max_load;
+            incremental = other.incremental;
+            migration_step = other.migration_step;
+            reserve( other.number_of_elements );
+            copyNodes( other, Ordered() );
         }
         return *this;
     }
@@ -76,16 +264,36 @@ public:
     {
         if( this != &other )
         {
+            // Nodes of 'other' cannot be adopted, they belong to a different allocator
+            if( !AllocatorTraits::propagate_on_container_move_assignment::value && pool.get_allocator() != other.pool.get_allocator() )
+                return *this = other;
+
             deleteAll();
-            delete[] table;
+            deallocateTable( table, size_of_table );
 
+            hashStorage() = other.hashStorage();
+            equalStorage() = other.equalStorage();
             size_of_table = other.size_of_table;
             table = other.table;
             number_of_elements = other.number_of_elements;
+            max_load = other.max_load;
+            old_table = other.old_table;
+            size_of_old_table = other.size_of_old_table;
+            migrate_index = other.migrate_index;
+            incremental = other.incremental;
+            migration_step = other.migration_step;
+            first_node = other.first_node;
+            last_node = other.last_node;
+            pool = std::move( other.pool );
 
             other.size_of_table = 0;
             other.table = nullptr;
             other.number_of_elements = 0;
+            other.old_table = nullptr;
+            other.size_of_old_table = 0;
+            other.migrate_index = 0;
+            other.first_node = nullptr;
+            other.last_node = nullptr;
         }
 
         return *this;
@@ -98,55 +306,96 @@ public:
 
     mapped_type& operator[]( const key_type& key )
     {
-        size_type hash_key = hashFunction( key );
-        HashNode* node = findNode( key );
+        return try_emplace( key ).first->second;
+    }
 
-        if( node == nullptr )
-        {
-            node = new HashNode( key, mapped_type() );
-            ++number_of_elements;
+    mapped_type& operator[]( key_type&& key )
+    {
+        return try_emplace( std::move(key) ).first->second;
+    }
 
-            if( table[ hash_key ] == nullptr )
-            {
-                table[ hash_key ] = node;
-            }
-            else
-            {
-                HashNode* tmp = table[ hash_key ];
-                while( tmp->next != nullptr )
-                    tmp = tmp->next;
+    // Finds 'key' or adds it with a default value. The key is hashed once and its chain walked once.
+    // 'second' is true when the key was inserted.
+    std::pair<iterator, bool> find_or_insert( const key_type& key )
+    {
+        return try_emplace( key );
+    }
 
-                tmp->next = node;
-                node->prev = tmp;
-            }
+    // Builds value_type from 'args' in a new node. The node is dropped if its key is already present.
+    template <typename... Args>
+    std::pair<iterator, bool> emplace( Args&&... args )
+    {
+        prepareTable();
+
+        HashNode* node = pool.create( 0, std::forward<Args>(args)... );
+        size_type hash;
+        HashNode* existing;
+        try
+        {
+            hash = hashOf( node->data.first );
+            existing = findNode( node->data.first, hash );
         }
-        return node->data.second;
+        catch( ... )
+        {
+            pool.destroy( node );
+            throw;
+        }
+
+        if( existing != nullptr )
+        {
+            pool.destroy( node );
+            return std::make_pair( iterator( this, existing, bucketOfHash( hash ) ), false );
+        }
+
+        node->storeHash( hash );
+        return std::make_pair( linkNode( node, hash ), true );
+    }
+
+    // Adds the value built from 'args' only if 'key' is missing, otherwise nothing is constructed
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace( const key_type& key, Args&&... args )
+    {
+        return tryEmplace( key, std::forward<Args>(args)... );
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace( key_type&& key, Args&&... args )
+    {
+        return tryEmplace( std::move(key), std::forward<Args>(args)... );
+    }
+
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign( const key_type& key, M&& mapped )
+    {
+        return insertOrAssign( key, std::forward<M>(mapped) );
+    }
+
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign( key_type&& key, M&& mapped )
+    {
+        return insertOrAssign( std::move(key), std::forward<M>(mapped) );
     }
 
     const mapped_type& valueOf( const key_type& key ) const
     {
-        HashNode* node = findNode(key);
-        if( node == nullptr )
-            throw std::out_of_range("valueOf");
-        return node->data.second;
+        return valueOfKey( key );
     }
 
     mapped_type& valueOf( const key_type& key )
     {
-        HashNode* node = findNode( key );
-        if( node == nullptr )
-            throw std::out_of_range("valueOf");
-        return node->data.second;
+        return valueOfKey( key );
     }
 
     const_iterator find( const key_type& key ) const
     {
-        return const_iterator( this, findNode(key), hashFunction(key) );
+        auto found = locate( key );
+        return const_iterator( this, found.first, found.second );
     }
 
     iterator find( const key_type& key )
     {
-        return iterator( this, findNode(key), hashFunction(key) );
+        auto found = locate( key );
+        return iterator( this, found.first, found.second );
     }
 
     void remove( const key_type& key )
@@ -154,11 +403,90 @@ public:
         remove( find( key ) );
     }
 
-    void remove(const const_iterator& it)
+    // Heterogeneous lookup, available when both Hash and KeyEqual declare 'is_transparent'.
+    // 'key' has to hash and compare like the equivalent key_type, no key_type is constructed.
+    template <typename K, typename H = Hash, typename E = KeyEqual,
+              typename = typename std::enable_if<detail::IsTransparent<H>::value && detail::IsTransparent<E>::value>::type>
+    const mapped_type& valueOf( const K& key ) const
+    {
+        return valueOfKey( key );
+    }
+
+    template <typename K, typename H = Hash, typename E = KeyEqual,
+              typename = typename std::enable_if<detail::IsTransparent<H>::value && detail::IsTransparent<E>::value>::type>
+    mapped_type& valueOf( const K& key )
+    {
+        return valueOfKey( key );
+    }
+
+    template <typename K, typename H = Hash, typename E = KeyEqual,
+              typename = typename std::enable_if<detail::IsTransparent<H>::value && detail::IsTransparent<E>::value>::type>
+    const_iterator find( const K& key ) const
+    {
+        auto found = locate( key );
+        return const_iterator( this, found.first, found.second );
+    }
+
+    template <typename K, typename H = Hash, typename E = KeyEqual,
+              typename = typename std::enable_if<detail::IsTransparent<H>::value && detail::IsTransparent<E>::value>::type>
+    iterator find( const K& key )
+    {
+        auto found = locate( key );
+        return iterator( this, found.first, found.second );
+    }
+
+    // Looks up all keys of [first, last) and writes an iterator (end() if missing) for each to 'out'.
+    // Keys are taken in groups: all buckets of a group are prefetched before any chain is walked,
+    // so the cache misses of different keys overlap. ForwardIt has to allow two passes.
+    template <typename ForwardIt, typename OutputIt>
+    OutputIt find_batch( ForwardIt first, ForwardIt last, OutputIt out )
+    {
+        HashNode* nodes[batch_size];
+        size_type buckets[batch_size];
+
+        while( first != last )
+        {
+            size_type count = findGroup( first, last, nodes, buckets );
+            for( size_type i = 0; i < count; ++i )
+                *out++ = iterator( this, nodes[i], buckets[i] );
+        }
+        return out;
+    }
+
+    template <typename ForwardIt, typename OutputIt>
+    OutputIt find_batch( ForwardIt first, ForwardIt last, OutputIt out ) const
+    {
+        HashNode* nodes[batch_size];
+        size_type buckets[batch_size];
+
+        while( first != last )
+        {
+            size_type count = findGroup( first, last, nodes, buckets );
+            for( size_type i = 0; i < count; ++i )
+                *out++ = const_iterator( this, nodes[i], buckets[i] );
+        }
+        return out;
+    }
+
+    // Iterators still go to remove(const_iterator)
+    template <typename K, typename H = Hash, typename E = KeyEqual,
+              typename = typename std::enable_if<detail::IsTransparent<H>::value && detail::IsTransparent<E>::value
+                                                 && !std::is_convertible<const K&, const_iterator>::value>::type>
+    void remove( const K& key )
+    {
+        remove( find( key ) );
+    }
+
+    // Returns the element following the removed one, other iterators stay valid
+    iterator remove(const const_iterator& it)
     {
         if(this != it.base_map || it == end())
             throw std::out_of_range("remove");
-        remove(it.node, it.node->data.first);
+
+        iterator next( it );
+        ++next;
+        removeNode( it.node );
+        return next;
     }
 
     size_type getSize() const
@@ -171,9 +499,11 @@ public:
         if(number_of_elements != other.number_of_elements)
             return false;
 
-        for(auto it = begin(), it2 = other.begin() ; it!=end(); ++it, ++it2)
+        // Iteration order depends on the table size and history, so look every key up
+        for(auto it = begin(); it != end(); ++it)
         {
-            if(*it != *it2)
+            HashNode* node = other.findNode( it->first );
+            if( node == nullptr || node->data.second != it->second )
                 return false;
         }
 
@@ -219,63 +549,707 @@ public:
         return cend();
     }
 
+    size_type bucket_count() const
+    {
+        return size_of_table;
+    }
+
+    float load_factor() const
+    {
+        if( size_of_table == 0 )
+            return 0.0f;
+        return static_cast<float>( number_of_elements ) / size_of_table;
+    }
+
+    float max_load_factor() const
+    {
+        return max_load;
+    }
+
+    void max_load_factor( float ml )
+    {
+        if( !( ml > 0.0f ) )
+            throw std::invalid_argument("max_load_factor");
+        max_load = ml;
+
+        if( load_factor() > max_load )
+            rehash( 0 );
+    }
+
+    // Sets the number of buckets to 'count', but never below what max_load_factor() allows
+    void rehash( size_type count )
+    {
+        finishMigration();
+
+        size_type minimal = static_cast<size_type>( std::ceil( number_of_elements / max_load ) );
+        if( count < minimal )
+            count = minimal;
+        count = BucketPolicy::bucketCount( count );
+        if( count == size_of_table )
+            return;
+
+        HashNode **new_table = allocateTable( count );
+
+        // Re-linking existing nodes, nothing is reallocated
+        const Word *bits = occupancyOf( table, size_of_table );
+        for( size_type i = nextOccupied( bits, size_of_table, 0 ); i < size_of_table; i = nextOccupied( bits, size_of_table, i + 1 ) )
+        {
+            HashNode *node = table[i];
+            while( node != nullptr )
+            {
+                HashNode *next = node->next;
+                pushFront( new_table, count, BucketPolicy::index( nodeHash( node ), count ), node );
+                node = next;
+            }
+        }
+
+        deallocateTable( table, size_of_table );
+        table = new_table;
+        size_of_table = count;
+    }
+
+    // Makes room for 'count' elements without further rehashing
+    void reserve( size_type count )
+    {
+        if( count > size_of_table * max_load )
+            rehash( static_cast<size_type>( std::ceil( count / max_load ) ) );
+    }
+
+    // In incremental mode growing the table does not move all nodes at once (only the new, empty table
+    // is allocated at once). Both tables are kept and every insertion migrates 'step' old buckets,
+    // or more when needed to finish before the table grows again - about 1 / max_load_factor() buckets,
+    // so a new migration never has to complete the previous one in one go.
+    // Removal migrates none, so iterators to other elements stay valid while erasing.
+    void incremental_rehash( bool enabled, size_type step = 8 )
+    {
+        if( !enabled )
+            finishMigration();
+
+        incremental = enabled;
+        migration_step = step > 0 ? step : 1;
+    }
+
+    bool incremental_rehash() const
+    {
+        return incremental;
+    }
+
+    bool rehashing() const
+    {
+        return old_table != nullptr;
+    }
+
+    hasher hash_function() const
+    {
+        return hashStorage();
+    }
+
+    key_equal key_eq() const
+    {
+        return equalStorage();
+    }
+
+    allocator_type get_allocator() const
+    {
+        return allocator_type( pool.get_allocator() );
+    }
+
 private:
     //const size_type size_of_table;
     size_type size_of_table;
 
-    struct HashNode
+    static const size_type batch_size = 16;
+    static const size_type no_bucket = static_cast<size_type>(-1);
+
+    using HashStorage = detail::EboStorage<Hash, 0>;
+    using EqualStorage = detail::EboStorage<KeyEqual, 1>;
+
+    using CachedHash = std::integral_constant<bool, CacheHashCode<key_type>::value>;
+
+    using Ordered = std::integral_constant<bool, InsertionOrdered>;
+
+    struct HashNode : detail::HashCode<CachedHash::value>, detail::ListLinks<HashNode, InsertionOrdered>
     {
         value_type data;
         HashNode *next;
         HashNode *prev;
-        HashNode(key_type key, mapped_type mapped) : data(std::make_pair( key, mapped )), next(nullptr), prev(nullptr) {}
-        HashNode(key_type key, mapped_type mapped, HashNode *prev) : HashNode(key, mapped) { this->prev = prev; }
-        ~HashNode() { delete next; }
+
+        // 'data' is built in place from 'args'
+        template <typename... Args>
+        explicit HashNode( size_type hash, Args&&... args )
+        : detail::HashCode<CachedHash::value>(hash), data( std::forward<Args>(args)... ), next(nullptr), prev(nullptr) {}
     };
+
+    using AllocatorTraits = std::allocator_traits<Allocator>;
+    using NodeAllocator = typename AllocatorTraits::template rebind_alloc<HashNode>;
+    using Word = std::uint64_t;
+    using TableAllocator = typename AllocatorTraits::template rebind_alloc<Word>;
+    using Pool = NodePool<HashNode, NodeAllocator>;
+
     HashNode **table;
     size_type number_of_elements;
+    float max_load;
+
+    // Table being migrated in incremental mode, buckets below 'migrate_index' are already moved
+    HashNode **old_table;
+    size_type size_of_old_table;
+    size_type migrate_index;
+    bool incremental;
+    size_type migration_step;
+
+    // Insertion order list, only used when InsertionOrdered
+    HashNode *first_node;
+    HashNode *last_node;
+
+    Pool pool;
+
+
+    // Node holding 'key' and its bucket (0 if there is no such node)
+    template <typename K>
+    std::pair<HashNode*, size_type> locate( const K& key ) const
+    {
+        if( size_of_table == 0 )
+            return std::make_pair( static_cast<HashNode*>(nullptr), size_type(0) );
+
+        const size_type hash = hashOf( key );
+        HashNode* node = findNode( key, hash );
+        return std::make_pair( node, node != nullptr ? bucketOfHash(hash) : 0 );
+    }
+
+    template <typename K>
+    mapped_type& valueOfKey( const K& key ) const
+    {
+        HashNode* node = findNode( key );
+        if( node == nullptr )
+            throw std::out_of_range("valueOf");
+        return node->data.second;
+    }
+
+    // Resolves up to batch_size keys from 'first' (which is advanced past them).
+    // Pass 1 hashes and prefetches bucket slots, pass 2 prefetches chain heads, pass 3 walks the chains.
+    template <typename ForwardIt>
+    size_type findGroup( ForwardIt& first, ForwardIt last, HashNode** nodes, size_type* buckets ) const
+    {
+        size_type hashes[batch_size];
+        ForwardIt group = first;
+        size_type count = 0;
+
+        for( ; first != last && count < batch_size; ++first, ++count )
+        {
+            if( size_of_table == 0 )
+                continue;
+
+            hashes[count] = hashOf( *first );
+            buckets[count] = bucketOfHash( hashes[count] );
+            detail::prefetch( &bucketAt( buckets[count] ) );
+        }
+
+        if( size_of_table == 0 )
+        {
+            for( size_type i = 0; i < count; ++i )
+                nodes[i] = nullptr;
+            return count;
+        }
+
+        for( size_type i = 0; i < count; ++i )
+        {
+            nodes[i] = bucketAt( buckets[i] );
+            if( nodes[i] != nullptr )
+                detail::prefetch( nodes[i] );
+        }
+
+        for( size_type i = 0; i < count; ++i, ++group )
+            nodes[i] = findInChain( nodes[i], *group, hashes[i] );
+
+        return count;
+    }
+
+    // Moved-from map has no table at all
+    void prepareTable()
+    {
+        if( size_of_table == 0 )
+            rehash( 1 );
+    }
+
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> tryEmplace( K&& key, Args&&... args )
+    {
+        prepareTable();
+
+        const size_type hash = hashOf( key );
+        HashNode* node = findNode( key, hash );
+
+        if( node != nullptr )
+            return std::make_pair( iterator( this, node, bucketOfHash( hash ) ), false );
+
+        node = pool.create( hash, std::piecewise_construct, std::forward_as_tuple( std::forward<K>(key) ),
+                            std::forward_as_tuple( std::forward<Args>(args)... ) );
+        return std::make_pair( linkNode( node, hash ), true );
+    }
+
+    template <typename K, typename M>
+    std::pair<iterator, bool> insertOrAssign( K&& key, M&& mapped )
+    {
+        prepareTable();
 
+        const size_type hash = hashOf( key );
+        HashNode* node = findNode( key, hash );
+
+        if( node != nullptr )
+        {
+            node->data.second = std::forward<M>(mapped);
+            return std::make_pair( iterator( this, node, bucketOfHash( hash ) ), false );
+        }
+
+        node = pool.create( hash, std::forward<K>(key), std::forward<M>(mapped) );
+        return std::make_pair( linkNode( node, hash ), true );
+    }
+
+    // Links a new node whose key is known to be missing
+    iterator linkNode( HashNode* node, size_type hash )
+    {
+        migrateBuckets( migrationBatch() );
+
+        // New nodes go to the head, the chain has just been searched anyway
+        const size_type index = bucketOfHash( hash );
+        if( index < size_of_old_table )
+            pushFront( old_table, size_of_old_table, index, node );
+        else
+            pushFront( table, size_of_table, index - size_of_old_table, node );
+        appendToList( node, Ordered() );
+        ++number_of_elements;
+
+        // Nodes are only re-linked, so 'node' stays valid
+        if( number_of_elements > size_of_table * max_load )
+            grow();
+
+        return iterator( this, node, bucketOfHash( hash ) );
+    }
 
     void deleteAll()
     {
         if( number_of_elements != 0 )
         {
-            for( size_type i = 0; i < size_of_table; ++i )
+            // Nothing to destroy, so the whole slab set is dropped at once
+            const bool destroy = !std::is_trivially_destructible<value_type>::value;
+
+            clearNodes( destroy, Ordered() );
+            if( !destroy )
+                pool.release();
+        }
+        first_node = nullptr;
+        last_node = nullptr;
+        deallocateTable( old_table, size_of_old_table );
+        old_table = nullptr;
+        size_of_old_table = 0;
+        migrate_index = 0;
+        number_of_elements = 0;
+    }
+
+    void clearNodes( bool destroy, std::false_type )
+    {
+        clearBuckets( table, size_of_table, destroy );
+        if( destroy && old_table != nullptr )
+            clearBuckets( old_table, size_of_old_table, destroy );
+    }
+
+    // Only the buckets of listed nodes are touched
+    void clearNodes( bool destroy, std::true_type )
+    {
+        for( HashNode *node = first_node; node != nullptr; )
+        {
+            HashNode *after = node->after;
+            if( node->prev == nullptr )
+                emptyBucket( bucketOfHash( nodeHash(node) ) );
+            if( destroy )
+                pool.destroy( node );
+            node = after;
+        }
+    }
+
+    void emptyBucket( size_type index )
+    {
+        bucketAt( index ) = nullptr;
+        if( index < size_of_old_table )
+            markEmpty( old_table, size_of_old_table, index );
+        else
+            markEmpty( table, size_of_table, index - size_of_old_table );
+    }
+
+    void copyNodes( const HashMap& other, std::false_type )
+    {
+        for( auto it = other.begin(); it != other.end(); ++it )
+            try_emplace( it->first, it->second );
+    }
+
+    // Keys of 'other' are unique, so nodes are only linked - no lookups, cached hashes are reused
+    void copyNodes( const HashMap& other, std::true_type )
+    {
+        if( other.number_of_elements == 0 )
+            return;
+
+        prepareTable();
+        for( const HashNode *source = other.first_node; source != nullptr; source = source->after )
+        {
+            const size_type hash = other.nodeHash( source );
+            HashNode *node = pool.create( hash, source->data );
+            pushFront( table, size_of_table, BucketPolicy::index( hash, size_of_table ), node );
+            appendToList( node, Ordered() );
+            ++number_of_elements;
+        }
+    }
+
+    void appendToList( HashNode*, std::false_type )
+    {}
+
+    void appendToList( HashNode* node, std::true_type )
+    {
+        node->before = last_node;
+        node->after = nullptr;
+        if( last_node != nullptr )
+            last_node->after = node;
+        else
+            first_node = node;
+        last_node = node;
+    }
+
+    void unlinkFromList( HashNode*, std::false_type )
+    {}
+
+    void unlinkFromList( HashNode* node, std::true_type )
+    {
+        if( node->before != nullptr )
+            node->before->after = node->after;
+        else
+            first_node = node->after;
+
+        if( node->after != nullptr )
+            node->after->before = node->before;
+        else
+            last_node = node->before;
+    }
+
+    // Empties only the occupied buckets (destroying their nodes if asked), skipping the rest word by word
+    void clearBuckets( HashNode** buckets, size_type count, bool destroy )
+    {
+        Word *bits = occupancyOf( buckets, count );
+        for( size_type i = nextOccupied( bits, count, 0 ); i < count; i = nextOccupied( bits, count, i + 1 ) )
+        {
+            if( destroy )
+                deleteChain( buckets[i] );
+            buckets[i] = nullptr;
+        }
+
+        for( size_type i = 0; i < occupancyWords( count ); ++i )
+            bits[i] = 0;
+    }
+
+    // Every table is one block from the same allocator as nodes: a bitmap of non-empty buckets,
+    // then the buckets. Iteration uses the bitmap to skip 64 empty buckets at a time.
+    static size_type occupancyWords( size_type count )
+    {
+        return ( count + 63 ) / 64;
+    }
+
+    static size_type tableWords( size_type count )
+    {
+        return occupancyWords( count ) + ( count * sizeof(HashNode*) + sizeof(Word) - 1 ) / sizeof(Word);
+    }
+
+    static Word* occupancyOf( HashNode** buckets, size_type count )
+    {
+        return reinterpret_cast<Word*>( buckets ) - occupancyWords( count );
+    }
+
+    HashNode** allocateTable( size_type count )
+    {
+        TableAllocator allocator( pool.get_allocator() );
+        Word *block = std::allocator_traits<TableAllocator>::allocate( allocator, tableWords( count ) );
+        for( size_type i = 0; i < occupancyWords( count ); ++i )
+            block[i] = 0;
+
+        HashNode **result = reinterpret_cast<HashNode**>( block + occupancyWords( count ) );
+        for( size_type i = 0; i < count; ++i )
+            result[i] = nullptr;
+        return result;
+    }
+
+    void deallocateTable( HashNode** buckets, size_type count )
+    {
+        if( buckets == nullptr )
+            return;
+
+        TableAllocator allocator( pool.get_allocator() );
+        std::allocator_traits<TableAllocator>::deallocate( allocator, occupancyOf( buckets, count ), tableWords( count ) );
+    }
+
+    static void pushFront( HashNode** buckets, size_type count, size_type index, HashNode* node )
+    {
+        node->prev = nullptr;
+        node->next = buckets[index];
+        if( buckets[index] != nullptr )
+            buckets[index]->prev = node;
+        else
+            occupancyOf( buckets, count )[index / 64] |= Word(1) << ( index % 64 );
+        buckets[index] = node;
+    }
+
+    static void markEmpty( HashNode** buckets, size_type count, size_type index )
+    {
+        occupancyOf( buckets, count )[index / 64] &= ~( Word(1) << ( index % 64 ) );
+    }
+
+    // First occupied bucket at or after 'from', 'count' if there is none
+    static size_type nextOccupied( const Word* bits, size_type count, size_type from )
+    {
+        if( from >= count )
+            return count;
+
+        size_type word = from / 64;
+        Word bit_set = bits[word] & ( ~Word(0) << ( from % 64 ) );
+        while( bit_set == 0 )
+        {
+            if( ++word == occupancyWords( count ) )
+                return count;
+            bit_set = bits[word];
+        }
+        return word * 64 + detail::lowestBit( bit_set );
+    }
+
+    // Last occupied bucket before 'before', no_bucket if there is none
+    static size_type previousOccupied( const Word* bits, size_type before )
+    {
+        if( before == 0 )
+            return no_bucket;
+
+        size_type word = ( before - 1 ) / 64;
+        Word bit_set = bits[word] & ( ~Word(0) >> ( 63 - ( before - 1 ) % 64 ) );
+        while( bit_set == 0 )
+        {
+            if( word == 0 )
+                return no_bucket;
+            bit_set = bits[--word];
+        }
+        return word * 64 + detail::highestBit( bit_set );
+    }
+
+    // Same for buckets numbered like bucketAt(), bucketCount() if there is none
+    size_type nextBucket( size_type from ) const
+    {
+        // Dense tables: the bucket itself is loaded next anyway
+        if( from < bucketCount() && bucketAt( from ) != nullptr )
+            return from;
+
+        if( from < size_of_old_table )
+        {
+            size_type index = nextOccupied( occupancyOf( old_table, size_of_old_table ), size_of_old_table, from );
+            if( index < size_of_old_table )
+                return index;
+            from = size_of_old_table;
+        }
+        if( table == nullptr )
+            return bucketCount();
+        return size_of_old_table + nextOccupied( occupancyOf( table, size_of_table ), size_of_table, from - size_of_old_table );
+    }
+
+    size_type previousBucket( size_type before ) const
+    {
+        if( before > size_of_old_table )
+        {
+            size_type index = previousOccupied( occupancyOf( table, size_of_table ), before - size_of_old_table );
+            if( index != no_bucket )
+                return size_of_old_table + index;
+            before = size_of_old_table;
+        }
+        if( before == 0 )
+            return no_bucket;
+        return previousOccupied( occupancyOf( old_table, size_of_old_table ), before );
+    }
+
+    void deleteChain( HashNode* node )
+    {
+        while( node != nullptr )
+        {
+            HashNode *next = node->next;
+            pool.destroy( node );
+            node = next;
+        }
+    }
+
+    void grow()
+    {
+        if( !incremental )
+        {
+            rehash( 2 * size_of_table );
+            return;
+        }
+
+        // Previous migration has to end before a new one starts. migrationBatch() has already finished it,
+        // unless rehash() was called in between (which finishes it as well)
+        finishMigration();
+
+        old_table = table;
+        size_of_old_table = size_of_table;
+        migrate_index = 0;
+
+        // Only moving the nodes is spread over later insertions. The new table is still allocated and
+        // cleared here, O(new size) but with no hashing or pointer chasing.
+        size_of_table *= 2;
+        table = allocateTable( size_of_table );
+
+        migrateBuckets( migration_step );
+    }
+
+    // Old buckets to migrate on this insertion: 'migration_step', but at least an even share of what is left
+    // over the insertions remaining before the table grows again (this one included)
+    size_type migrationBatch() const
+    {
+        if( old_table == nullptr )
+            return migration_step;
+
+        const size_type left = size_of_old_table - migrate_index;
+        const size_type limit = static_cast<size_type>( size_of_table * max_load );
+        const size_type insertions = limit >= number_of_elements ? limit - number_of_elements + 1 : 1;
+        const size_type share = ( left + insertions - 1 ) / insertions;
+        return share > migration_step ? share : migration_step;
+    }
+
+    void migrateBuckets( size_type count )
+    {
+        for( ; old_table != nullptr && count > 0; --count )
+        {
+            HashNode *node = old_table[migrate_index];
+            while( node != nullptr )
+            {
+                HashNode *next = node->next;
+                pushFront( table, size_of_table, BucketPolicy::index( nodeHash( node ), size_of_table ), node );
+                node = next;
+            }
+            old_table[migrate_index] = nullptr;
+            markEmpty( old_table, size_of_old_table, migrate_index );
+
+            if( ++migrate_index == size_of_old_table )
             {
-                delete table[i];
-                table[i] = nullptr;
+                deallocateTable( old_table, size_of_old_table );
+                old_table = nullptr;
+                size_of_old_table = 0;
+                migrate_index = 0;
             }
         }
-        number_of_elements = 0;
     }
 
-    void remove( HashNode* node, const key_type& key )
+    void finishMigration()
+    {
+        migrateBuckets( size_of_old_table );
+    }
+
+    // Buckets of both tables are numbered together: old table first, then the current one
+    size_type bucketCount() const
+    {
+        return size_of_old_table + size_of_table;
+    }
+
+    HashNode*& bucketAt( size_type index ) const
+    {
+        if( index < size_of_old_table )
+            return old_table[index];
+        return table[index - size_of_old_table];
+    }
+
+    size_type bucketOfHash( size_type hash ) const
+    {
+        if( old_table != nullptr )
+        {
+            size_type old_index = BucketPolicy::index( hash, size_of_old_table );
+            if( old_index >= migrate_index )
+                return old_index;
+        }
+        return size_of_old_table + BucketPolicy::index( hash, size_of_table );
+    }
+
+    void removeNode( HashNode* node )
     {
         if(node->prev == nullptr)
-            table[hashFunction(key)] = node->next;
+        {
+            const size_type index = bucketOfHash( nodeHash(node) );
+            if( node->next == nullptr )
+                emptyBucket( index );
+            else
+                bucketAt( index ) = node->next;
+        }
         else
             node->prev->next = node->next;
 
         if( node->next != nullptr )
             node->next->prev = node->prev;
 
-        node->next = nullptr;
-        delete node;
+        unlinkFromList( node, Ordered() );
+        pool.destroy( node );
         number_of_elements--;
     }
 
-    size_type hashFunction( const key_type& key ) const
+    const Hash& hashStorage() const
+    {
+        return HashStorage::get();
+    }
+
+    Hash& hashStorage()
+    {
+        return HashStorage::get();
+    }
+
+    const KeyEqual& equalStorage() const
+    {
+        return EqualStorage::get();
+    }
+
+    KeyEqual& equalStorage()
+    {
+        return EqualStorage::get();
+    }
+
+    template <typename K>
+    size_type hashOf( const K& key ) const
+    {
+        return hashStorage()( key );
+    }
+
+    size_type nodeHash( const HashNode* node ) const
+    {
+        return nodeHash( node, CachedHash() );
+    }
+
+    size_type nodeHash( const HashNode* node, std::true_type ) const
+    {
+        return node->hash_code;
+    }
+
+    size_type nodeHash( const HashNode* node, std::false_type ) const
     {
-        std::hash<key_type> tmp;
-        return tmp(key)%size_of_table;
+        return hashOf( node->data.first );
     }
 
-    HashNode* findNode( const key_type& key ) const
+    template <typename K>
+    HashNode* findNode( const K& key ) const
+    {
+        if( size_of_table == 0 )
+            return nullptr;
+
+        return findNode( key, hashOf(key) );
+    }
+
+    template <typename K>
+    HashNode* findNode( const K& key, size_type hash ) const
+    {
+        return findInChain( bucketAt( bucketOfHash(hash) ), key, hash );
+    }
+
+    template <typename K>
+    HashNode* findInChain( HashNode* node, const K& key, size_type hash ) const
     {
-        HashNode *node = table[ hashFunction(key) ];
         while( node != nullptr )
         {
-            if( node->data.first == key )
+            if( node->mayMatch( hash ) && equalStorage()( node->data.first, key ) )
                 return node;
 
             node = node->next;
@@ -283,24 +1257,86 @@ private:
         return node;
     }
 
+    // Iterator steps, along the chains and buckets or along the insertion order list
+    void stepForward( HashNode*& node, size_type& index, std::false_type ) const
+    {
+        if( node->next != nullptr )
+        {
+            node = node->next;
+            return;
+        }
+
+        index = nextBucket( index + 1 );
+        node = index < bucketCount() ? bucketAt(index) : nullptr;
+    }
+
+    void stepForward( HashNode*& node, size_type&, std::true_type ) const
+    {
+        node = node->after;
+    }
+
+    // False when there is nothing before 'node'
+    bool stepBack( HashNode*& node, size_type& index, std::false_type ) const
+    {
+        if( node != nullptr && node != bucketAt(index) )
+        {
+            node = node->prev;
+            return true;
+        }
+
+        size_type previous = previousBucket( index );
+        if( previous == no_bucket )
+            return false;
+
+        index = previous;
+        node = bucketAt(index);
+        while( node->next != nullptr )
+            node = node->next;
+        return true;
+    }
+
+    bool stepBack( HashNode*& node, size_type&, std::true_type ) const
+    {
+        HashNode *before = node == nullptr ? last_node : node->before;
+        if( before == nullptr )
+            return false;
+
+        node = before;
+        return true;
+    }
+
     std::pair<HashNode*, size_type> findFirstNode() const
     {
-        size_type index = 0;
+        return findFirstNode( Ordered() );
+    }
+
+    std::pair<HashNode*, size_type> findFirstNode( std::true_type ) const
+    {
+        return std::make_pair( first_node, size_type(0) );
+    }
 
-        while( index < size_of_table && table[index] == nullptr )
-            ++index;
+    std::pair<HashNode*, size_type> findFirstNode( std::false_type ) const
+    {
+        size_type index = nextBucket( 0 );
 
         HashNode *node = nullptr;
-        if( index < size_of_table )
-            node = table[index];
+        if( index < bucketCount() )
+            node = bucketAt(index);
 
         return std::make_pair( node, index );
     }
 
 };
 
-template <typename KeyType, typename ValueType>
-class HashMap<KeyType, ValueType>::ConstIterator
+// HashMap iterated in insertion order (re-adding a removed key puts it at the end)
+template <typename KeyType, typename ValueType,
+          typename Hash = std::hash<KeyType>,
+          typename KeyEqual = std::equal_to<KeyType>,
+          typename Allocator = std::allocator<std::pair<const KeyType, ValueType>>>
+using LinkedHashMap = HashMap<KeyType, ValueType, Hash, KeyEqual, Allocator, ModuloBuckets, true>;
+
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual, typename Allocator, typename BucketPolicy, bool InsertionOrdered>
+class HashMap<KeyType, ValueType, Hash, KeyEqual, Allocator, BucketPolicy, InsertionOrdered>::ConstIterator
 {
     const HashMap *base_map;
     HashNode *node;
@@ -316,7 +1352,7 @@ public:
     explicit ConstIterator( const HashMap *base_map = nullptr, HashNode *node = nullptr, size_type index = 0 ) : base_map(base_map), node(node), index(index)
     {
         if( node == nullptr && base_map != nullptr )
-            this->index = base_map->size_of_table;
+            this->index = base_map->bucketCount();
     }
 
     ConstIterator( const ConstIterator& other ) : ConstIterator(other.base_map, other.node, other.index)
@@ -328,19 +1364,7 @@ public:
         {
             throw std::out_of_range("operator++");
         }
-        else if(node->next != nullptr)
-        {
-            node = node->next;
-        }
-        else
-        {
-            for( ++index; index < base_map->size_of_table && base_map->table[index] == nullptr; ++index );
-
-            if( index >= base_map->size_of_table )
-                node = nullptr;
-            else
-                node = base_map->table[index];
-        }
+        base_map->stepForward( node, index, Ordered() );
         return *this;
     }
 
@@ -353,27 +1377,8 @@ public:
 
     ConstIterator& operator--()
     {
-        if( base_map == nullptr )
+        if( base_map == nullptr || !base_map->stepBack( node, index, Ordered() ) )
             throw std::out_of_range("operator--");
-        else if( node == nullptr || node == base_map->table[index] )
-        {
-            if( index == 0 && base_map->table[index] == nullptr )
-                throw std::out_of_range("operator--");
-
-            for( --index; index > 0 && base_map->table[index] == nullptr; --index );
-
-            if( index == 0 && base_map->table[index] == nullptr )
-                throw std::out_of_range("operator--");
-
-            node = base_map->table[index];
-            while( node->next != nullptr )
-                node = node->next;
-        }
-        else
-        {
-            node = node->prev;
-        }
-
         return *this;
   }
 
@@ -398,7 +1403,7 @@ public:
 
     bool operator==( const ConstIterator& other ) const
     {
-        return base_map == other.base_map && node == other.node && index == other.index;
+        return base_map == other.base_map && node == other.node;
     }
 
     bool operator!=( const ConstIterator& other ) const
@@ -407,8 +1412,9 @@ public:
     }
 };
 
-template <typename KeyType, typename ValueType>
-class HashMap<KeyType, ValueType>::Iterator : public HashMap<KeyType, ValueType>::ConstIterator
+template <typename KeyType, typename ValueType, typename Hash, typename KeyEqual, typename Allocator, typename BucketPolicy, bool InsertionOrdered>
+class HashMap<KeyType, ValueType, Hash, KeyEqual, Allocator, BucketPolicy, InsertionOrdered>::Iterator
+: public HashMap<KeyType, ValueType, Hash, KeyEqual, Allocator, BucketPolicy, InsertionOrdered>::ConstIterator
 {
 public:
   using reference = typename HashMap::reference;
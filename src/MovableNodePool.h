@@ -0,0 +1,230 @@
+#ifndef AISDI_MAPS_MOVABLENODEPOOL_H
+#define AISDI_MAPS_MOVABLENODEPOOL_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace aisdi
+{
+
+// Memory for nodes of a single type, taken from slabs of growing size - as NodePool, but a node
+// may be destroyed by any pool of an equal allocator, not only by the one that created it.
+// So nodes can move between containers without being copied.
+// Every slot knows its slab and every slab counts its living nodes. A node destroyed by another
+// pool still goes back to the free list of the pool owning its slab. A pool giving up its slabs
+// (release() or the destructor) keeps those that still hold living nodes of other pools; each of them
+// is given back by the pool destroying its last node. Memory comes back a slab at a time, nothing is locked:
+// pools exchanging nodes have to be used from one thread, as everything else here.
+template <typename Node, typename Allocator = std::allocator<Node>>
+class MovableNodePool
+{
+public:
+    using allocator_type = Allocator;
+
+    explicit MovableNodePool( const Allocator& alloc = Allocator() )
+    : allocator(alloc), state(nullptr)
+    {}
+
+    MovableNodePool( const MovableNodePool& ) = delete;
+    MovableNodePool& operator=( const MovableNodePool& ) = delete;
+
+    MovableNodePool( MovableNodePool&& other ) : MovableNodePool( other.allocator )
+    {
+        swap( other );
+    }
+
+    // Takes over the allocator as well, the owner decides whether it may propagate
+    MovableNodePool& operator=( MovableNodePool&& other )
+    {
+        if( this != &other )
+        {
+            release();
+            allocator = other.allocator;
+            swap( other );
+        }
+        return *this;
+    }
+
+    ~MovableNodePool()
+    {
+        release();
+    }
+
+    template <typename... Args>
+    Node* create( Args&&... args )
+    {
+        void *memory = allocate();
+        try
+        {
+            return new (memory) Node( std::forward<Args>(args)... );
+        }
+        catch( ... )
+        {
+            deallocate( memory );
+            throw;
+        }
+    }
+
+    // 'node' may come from any pool of an equal allocator
+    void destroy( Node* node )
+    {
+        node->~Node();
+        deallocate( node );
+    }
+
+    // Gives back the slabs without living nodes and leaves the others to the pools destroying their nodes.
+    // Nodes are NOT destroyed, so every node has to be destroyed (by any pool) before, or its slab is never given back.
+    void release()
+    {
+        if( state == nullptr )
+            return;
+
+        for( Slab *slab = state->slabs; slab != nullptr; )
+        {
+            Slab *next_slab = slab->next_slab;
+            if( slab->live == 0 )
+                deallocateSlab( slab );
+            else
+                slab->owner = nullptr;
+            slab = next_slab;
+        }
+
+        StateAllocator state_allocator( allocator );
+        StateTraits::destroy( state_allocator, state );
+        StateTraits::deallocate( state_allocator, state, 1 );
+        state = nullptr;
+    }
+
+    allocator_type get_allocator() const
+    {
+        return allocator_type( allocator );
+    }
+
+    // Swaps the slabs only, allocators have to be equal
+    void swap( MovableNodePool& other )
+    {
+        std::swap( state, other.state );
+    }
+
+private:
+    struct State;
+
+    // Kept at the start of its memory, before the slots
+    struct Slab
+    {
+        Slab *next_slab;
+        std::size_t size; // In slots, the header included
+        std::size_t live;
+        State *owner;     // nullptr once its pool has given it up
+    };
+
+    struct Slot
+    {
+        Slab *slab;
+        union Body
+        {
+            Slot *next;
+            typename std::aligned_storage<sizeof(Node), alignof(Node)>::type storage;
+        } body;
+    };
+
+    // Behind a pointer, so slabs can find their pool's free list even after the pool has moved
+    struct State
+    {
+        Slab *slabs = nullptr;
+        Slot *free_list = nullptr;
+        Slot *next_free = nullptr;    // Not yet used part of the newest slab
+        Slot *slab_end = nullptr;
+        std::size_t next_slab_size = first_slab_size;
+    };
+
+    using SlotAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Slot>;
+    using SlotTraits = std::allocator_traits<SlotAllocator>;
+    using StateAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<State>;
+    using StateTraits = std::allocator_traits<StateAllocator>;
+
+    static const std::size_t first_slab_size = 16;
+    static const std::size_t max_slab_size = 4096;
+    static const std::size_t header_slots = ( sizeof(Slab) + sizeof(Slot) - 1 ) / sizeof(Slot);
+
+    SlotAllocator allocator;
+    State *state;
+
+    static Slot* slotOf( void* memory )
+    {
+        return reinterpret_cast<Slot*>( static_cast<char*>( memory ) - offsetof( Slot, body ) );
+    }
+
+    void* allocate()
+    {
+        if( state == nullptr )
+        {
+            StateAllocator state_allocator( allocator );
+            State *new_state = StateTraits::allocate( state_allocator, 1 );
+            StateTraits::construct( state_allocator, new_state );
+            state = new_state;
+        }
+
+        Slot *slot = state->free_list;
+        if( slot != nullptr )
+        {
+            state->free_list = slot->body.next;
+        }
+        else
+        {
+            if( state->next_free == state->slab_end )
+                addSlab();
+            slot = state->next_free++;
+            slot->slab = state->slabs;
+        }
+
+        ++slot->slab->live;
+        return &slot->body;
+    }
+
+    void deallocate( void* memory )
+    {
+        Slot *slot = slotOf( memory );
+        Slab *slab = slot->slab;
+        --slab->live;
+
+        if( slab->owner != nullptr )
+        {
+            slot->body.next = slab->owner->free_list;
+            slab->owner->free_list = slot;
+        }
+        else if( slab->live == 0 )
+        {
+            deallocateSlab( slab );
+        }
+    }
+
+    void addSlab()
+    {
+        Slot *memory = SlotTraits::allocate( allocator, state->next_slab_size );
+        Slab *slab = ::new (static_cast<void*>( memory )) Slab();
+        slab->next_slab = state->slabs;
+        slab->size = state->next_slab_size;
+        slab->live = 0;
+        slab->owner = state;
+        state->slabs = slab;
+
+        state->next_free = memory + header_slots;
+        state->slab_end = memory + state->next_slab_size;
+
+        if( state->next_slab_size < max_slab_size )
+            state->next_slab_size *= 2;
+    }
+
+    void deallocateSlab( Slab* slab )
+    {
+        SlotTraits::deallocate( allocator, reinterpret_cast<Slot*>( slab ), slab->size );
+    }
+};
+
+}
+
+#endif /* AISDI_MAPS_MOVABLENODEPOOL_H */
@@ -0,0 +1,169 @@
+#ifndef AISDI_MAPS_NODEPOOL_H
+#define AISDI_MAPS_NODEPOOL_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace aisdi
+{
+
+// Memory for nodes of a single type, taken from slabs of growing size.
+// Freed nodes are kept on an intrusive free list and reused before a new slab is taken,
+// all slabs are given back at once by release() or by the destructor.
+// Slabs are obtained from 'Allocator' (rebound to the slot type).
+template <typename Node, typename Allocator = std::allocator<Node>>
+class NodePool
+{
+public:
+    using allocator_type = Allocator;
+
+    explicit NodePool( const Allocator& alloc = Allocator() )
+    : allocator(alloc), slabs(nullptr), free_list(nullptr), next_free(nullptr), slab_end(nullptr), next_slab_size(first_slab_size)
+    {}
+
+    NodePool( const NodePool& ) = delete;
+    NodePool& operator=( const NodePool& ) = delete;
+
+    NodePool( NodePool&& other ) : NodePool( other.allocator )
+    {
+        swap( other );
+    }
+
+    // Takes over the allocator as well, the owner decides whether it may propagate
+    NodePool& operator=( NodePool&& other )
+    {
+        if( this != &other )
+        {
+            release();
+            allocator = other.allocator;
+            swap( other );
+        }
+        return *this;
+    }
+
+    ~NodePool()
+    {
+        release();
+    }
+
+    template <typename... Args>
+    Node* create( Args&&... args )
+    {
+        void *memory = allocate();
+        try
+        {
+            return new (memory) Node( std::forward<Args>(args)... );
+        }
+        catch( ... )
+        {
+            deallocate( memory );
+            throw;
+        }
+    }
+
+    void destroy( Node* node )
+    {
+        node->~Node();
+        deallocate( node );
+    }
+
+    // Gives all slabs back. Nodes still living in them are NOT destroyed,
+    // so it is only a shortcut for nodes with trivial destructors (or already destroyed ones).
+    void release()
+    {
+        while( slabs != nullptr )
+        {
+            Slot *next_slab = slabs->header.next_slab;
+            SlotTraits::deallocate( allocator, slabs, slabs->header.size );
+            slabs = next_slab;
+        }
+        free_list = nullptr;
+        next_free = nullptr;
+        slab_end = nullptr;
+        next_slab_size = first_slab_size;
+    }
+
+    allocator_type get_allocator() const
+    {
+        return allocator_type( allocator );
+    }
+
+    // Swaps the slabs only, allocators have to be equal
+    void swap( NodePool& other )
+    {
+        std::swap( slabs, other.slabs );
+        std::swap( free_list, other.free_list );
+        std::swap( next_free, other.next_free );
+        std::swap( slab_end, other.slab_end );
+        std::swap( next_slab_size, other.next_slab_size );
+    }
+
+private:
+    // First slot of every slab is its header, the rest hold nodes
+    union Slot
+    {
+        Slot *next;
+        struct
+        {
+            Slot *next_slab;
+            std::size_t size;
+        } header;
+        typename std::aligned_storage<sizeof(Node), alignof(Node)>::type storage;
+    };
+
+    using SlotAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Slot>;
+    using SlotTraits = std::allocator_traits<SlotAllocator>;
+
+    static const std::size_t first_slab_size = 16;
+    static const std::size_t max_slab_size = 4096;
+
+    SlotAllocator allocator;
+    Slot *slabs;
+    Slot *free_list;
+    Slot *next_free;    // Not yet used part of the newest slab
+    Slot *slab_end;
+    std::size_t next_slab_size;
+
+    void* allocate()
+    {
+        if( free_list != nullptr )
+        {
+            Slot *slot = free_list;
+            free_list = slot->next;
+            return slot;
+        }
+
+        if( next_free == slab_end )
+            addSlab();
+
+        return next_free++;
+    }
+
+    void deallocate( void* memory )
+    {
+        Slot *slot = static_cast<Slot*>( memory );
+        slot->next = free_list;
+        free_list = slot;
+    }
+
+    void addSlab()
+    {
+        Slot *slab = SlotTraits::allocate( allocator, next_slab_size );
+        slab->header.next_slab = slabs;
+        slab->header.size = next_slab_size;
+        slabs = slab;
+
+        next_free = slab + 1;
+        slab_end = slab + next_slab_size;
+
+        if( next_slab_size < max_slab_size )
+            next_slab_size *= 2;
+    }
+};
+
+}
+
+#endif /* AISDI_MAPS_NODEPOOL_H */
@@ -0,0 +1,24 @@
+#ifndef AISDI_MAPS_PREFETCH_H
+#define AISDI_MAPS_PREFETCH_H
+
+namespace aisdi
+{
+
+namespace detail
+{
+
+// Hint to load the cache line holding 'address' for reading, no-op where unsupported
+inline void prefetch( const void* address )
+{
+#if defined(__GNUC__)
+    __builtin_prefetch( address, 0, 3 );
+#else
+    (void) address;
+#endif
+}
+
+}
+
+}
+
+#endif /* AISDI_MAPS_PREFETCH_H */
@@ -0,0 +1,711 @@
+#ifndef AISDI_MAPS_SWISSHASHMAP_H
+#define AISDI_MAPS_SWISSHASHMAP_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include <functional>
+
+#if defined(__SSE2__) && !defined(AISDI_NO_SIMD)
+#  include <emmintrin.h>
+#  define AISDI_SWISS_SSE2 1
+#endif
+
+namespace aisdi
+{
+
+// Open addressing hash map probing whole groups of slots at once.
+// Every slot has a control byte: empty, deleted or the low 7 bits of the hash
+// of its key (H2). Slots are split into groups of 16, a lookup compares H2 against
+// all 16 control bytes of a group with one SSE2 compare and touches keys only on a match.
+// The load factor is at most 7/8, which is also the default.
+template <typename KeyType, typename ValueType>
+class SwissHashMap
+{
+public:
+    using key_type = KeyType;
+    using mapped_type = ValueType;
+    using value_type = std::pair<const key_type, mapped_type>;
+    using size_type = std::size_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+
+    class ConstIterator;
+    class Iterator;
+    using iterator = Iterator;
+    using const_iterator = ConstIterator;
+
+public:
+    SwissHashMap( size_type tableSize = 16 )
+    : slots(nullptr), ctrl(nullptr), capacity(0), number_of_elements(0), growth_left(0), max_load(max_load_limit)
+    {
+        allocate( roundCapacity( tableSize ) );
+    }
+
+    SwissHashMap( std::initializer_list<value_type> list ) : SwissHashMap()
+    {
+        reserve( list.size() );
+        for( auto it = list.begin(); it != list.end(); ++it )
+            (*this)[(*it).first] = (*it).second;
+    }
+
+    SwissHashMap( const SwissHashMap& other ) : SwissHashMap( 0 )
+    {
+        *this = other;
+    }
+
+    SwissHashMap( SwissHashMap&& other )
+    : slots(other.slots), ctrl(other.ctrl), capacity(other.capacity),
+      number_of_elements(other.number_of_elements), growth_left(other.growth_left), max_load(other.max_load)
+    {
+        other.slots = nullptr;
+        other.ctrl = nullptr;
+        other.capacity = 0;
+        other.number_of_elements = 0;
+        other.growth_left = 0;
+    }
+
+    ~SwissHashMap()
+    {
+        deleteAll();
+        deallocate( slots, ctrl );
+    }
+
+    SwissHashMap& operator=( const SwissHashMap& other )
+    {
+        if( this != &other )
+        {
+            deleteAll();
+            max_load = other.max_load;
+
+            if( capacity != other.capacity )
+            {
+                deallocate( slots, ctrl );
+                slots = nullptr;
+                ctrl = nullptr;
+                capacity = 0;
+                allocate( other.capacity );
+            }
+
+            // Same capacity and hash - control bytes (tombstones included) are copied as they are
+            if( capacity > 0 )
+                std::memcpy( ctrl, other.ctrl, capacity );
+            for( size_type i = 0; i < capacity; ++i )
+                if( isFull( ctrl[i] ) )
+                    new (slots + i) value_type( other.slots[i] );
+
+            number_of_elements = other.number_of_elements;
+            growth_left = other.growth_left;
+        }
+        return *this;
+    }
+
+    SwissHashMap& operator=( SwissHashMap&& other )
+    {
+        if( this != &other )
+        {
+            deleteAll();
+            deallocate( slots, ctrl );
+
+            slots = other.slots;
+            ctrl = other.ctrl;
+            capacity = other.capacity;
+            number_of_elements = other.number_of_elements;
+            growth_left = other.growth_left;
+            max_load = other.max_load;
+
+            other.slots = nullptr;
+            other.ctrl = nullptr;
+            other.capacity = 0;
+            other.number_of_elements = 0;
+            other.growth_left = 0;
+        }
+        return *this;
+    }
+
+    bool isEmpty() const
+    {
+        return (number_of_elements == 0);
+    }
+
+    mapped_type& operator[]( const key_type& key )
+    {
+        size_type hash = hashOf( key );
+        size_type index = findIndex( key, hash );
+        if( index != capacity )
+            return slots[index].second;
+
+        if( growth_left == 0 )
+            rehashForInsert();
+
+        index = findInsertSlot( hash );
+        new (slots + index) value_type( key, mapped_type() );
+        setFull( index, hash );
+        return slots[index].second;
+    }
+
+    const mapped_type& valueOf( const key_type& key ) const
+    {
+        size_type index = findIndex( key, hashOf( key ) );
+        if( index == capacity )
+            throw std::out_of_range("valueOf");
+        return slots[index].second;
+    }
+
+    mapped_type& valueOf( const key_type& key )
+    {
+        size_type index = findIndex( key, hashOf( key ) );
+        if( index == capacity )
+            throw std::out_of_range("valueOf");
+        return slots[index].second;
+    }
+
+    const_iterator find( const key_type& key ) const
+    {
+        return const_iterator( this, findIndex( key, hashOf( key ) ) );
+    }
+
+    iterator find( const key_type& key )
+    {
+        return iterator( this, findIndex( key, hashOf( key ) ) );
+    }
+
+    void remove( const key_type& key )
+    {
+        remove( find( key ) );
+    }
+
+    // Returns the element following the removed one, other iterators stay valid
+    iterator remove( const const_iterator& it )
+    {
+        if( this != it.base_map || it == end() )
+            throw std::out_of_range("remove");
+        eraseIndex( it.index );
+        return iterator( this, firstFull( it.index + 1 ) );
+    }
+
+    size_type getSize() const
+    {
+        return number_of_elements;
+    }
+
+    bool operator==( const SwissHashMap& other ) const
+    {
+        if( number_of_elements != other.number_of_elements )
+            return false;
+
+        for( auto it = begin(); it != end(); ++it )
+        {
+            size_type index = other.findIndex( it->first, other.hashOf( it->first ) );
+            if( index == other.capacity || other.slots[index].second != it->second )
+                return false;
+        }
+        return true;
+    }
+
+    bool operator!=( const SwissHashMap& other ) const
+    {
+        return !(*this == other);
+    }
+
+    iterator begin()
+    {
+        return iterator( this, firstFull( 0 ) );
+    }
+
+    iterator end()
+    {
+        return iterator( this, capacity );
+    }
+
+    const_iterator cbegin() const
+    {
+        return const_iterator( this, firstFull( 0 ) );
+    }
+
+    const_iterator cend() const
+    {
+        return const_iterator( this, capacity );
+    }
+
+    const_iterator begin() const
+    {
+        return cbegin();
+    }
+
+    const_iterator end() const
+    {
+        return cend();
+    }
+
+    size_type bucket_count() const
+    {
+        return capacity;
+    }
+
+    float load_factor() const
+    {
+        if( capacity == 0 )
+            return 0.0f;
+        return static_cast<float>( number_of_elements ) / capacity;
+    }
+
+    float max_load_factor() const
+    {
+        return max_load;
+    }
+
+    // Probing needs empty slots to stop at, so values above 7/8 are lowered to it
+    void max_load_factor( float ml )
+    {
+        if( !( ml > 0.0f ) )
+            throw std::invalid_argument("max_load_factor");
+
+        const size_type used = maxFill( capacity ) - growth_left; // Elements and tombstones
+        max_load = ml < max_load_limit ? ml : max_load_limit;
+
+        if( used > maxFill( capacity ) )
+            rehash( capacity );
+        else
+            growth_left = maxFill( capacity ) - used;
+    }
+
+    // Capacity is always a power of two, at least one group, and never below what
+    // max_load_factor() allows. Rehashing also drops all tombstones.
+    void rehash( size_type count )
+    {
+        size_type new_capacity = roundCapacity( count );
+        while( maxFill( new_capacity ) < number_of_elements )
+            new_capacity *= 2;
+
+        value_type *old_slots = slots;
+        std::int8_t *old_ctrl = ctrl;
+        size_type old_capacity = capacity;
+
+        allocate( new_capacity );
+        number_of_elements = 0;
+
+        for( size_type i = 0; i < old_capacity; ++i )
+        {
+            if( isFull( old_ctrl[i] ) )
+            {
+                size_type hash = hashOf( old_slots[i].first );
+                size_type index = findInsertSlot( hash );
+                new (slots + index) value_type( std::move( old_slots[i] ) );
+                setFull( index, hash );
+                old_slots[i].~value_type();
+            }
+        }
+
+        deallocate( old_slots, old_ctrl );
+    }
+
+    void reserve( size_type count )
+    {
+        if( count > maxFill( capacity ) )
+            rehash( static_cast<size_type>( std::ceil( count / max_load_factor() ) ) );
+    }
+
+private:
+    value_type *slots;
+    std::int8_t *ctrl;
+    size_type capacity;
+    size_type number_of_elements;
+    size_type growth_left; // Empty slots that may still be filled before rehashing
+    float max_load;
+
+    static constexpr size_type group_width = 16;
+    static constexpr std::int8_t ctrl_empty = -128;
+    static constexpr std::int8_t ctrl_deleted = -2;
+    static constexpr float max_load_limit = 0.875f;
+
+    // Bit i of a mask stands for the i-th slot of a group
+    class Group
+    {
+    public:
+        explicit Group( const std::int8_t *pos )
+        {
+#ifdef AISDI_SWISS_SSE2
+            bytes = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pos ) );
+#else
+            std::memcpy( bytes, pos, group_width );
+#endif
+        }
+
+        std::uint32_t match( std::int8_t tag ) const
+        {
+#ifdef AISDI_SWISS_SSE2
+            return static_cast<std::uint32_t>( _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_set1_epi8( tag ), bytes ) ) );
+#else
+            std::uint32_t mask = 0;
+            for( size_type i = 0; i < group_width; ++i )
+                if( bytes[i] == tag )
+                    mask |= 1u << i;
+            return mask;
+#endif
+        }
+
+        std::uint32_t matchEmpty() const
+        {
+            return match( ctrl_empty );
+        }
+
+        // Empty and deleted are the only negative control bytes
+        std::uint32_t matchEmptyOrDeleted() const
+        {
+#ifdef AISDI_SWISS_SSE2
+            return static_cast<std::uint32_t>( _mm_movemask_epi8( bytes ) );
+#else
+            std::uint32_t mask = 0;
+            for( size_type i = 0; i < group_width; ++i )
+                if( bytes[i] < 0 )
+                    mask |= 1u << i;
+            return mask;
+#endif
+        }
+
+    private:
+#ifdef AISDI_SWISS_SSE2
+        __m128i bytes;
+#else
+        std::int8_t bytes[group_width];
+#endif
+    };
+
+    static unsigned lowestBit( std::uint32_t mask )
+    {
+#if defined(__GNUC__)
+        return static_cast<unsigned>( __builtin_ctz( mask ) );
+#else
+        unsigned bit = 0;
+        while( ( mask & 1u ) == 0 )
+        {
+            mask >>= 1;
+            ++bit;
+        }
+        return bit;
+#endif
+    }
+
+    static bool isFull( std::int8_t byte )
+    {
+        return byte >= 0;
+    }
+
+    static size_type roundCapacity( size_type count )
+    {
+        size_type result = group_width;
+        while( result < count )
+            result *= 2;
+        return result;
+    }
+
+    size_type maxFill( size_type count ) const
+    {
+        return static_cast<size_type>( count * static_cast<double>( max_load ) );
+    }
+
+    void allocate( size_type count )
+    {
+        value_type *new_slots = static_cast<value_type*>( ::operator new( count * sizeof(value_type) ) );
+        std::int8_t *new_ctrl;
+        try
+        {
+            new_ctrl = new std::int8_t [count];
+        }
+        catch( ... )
+        {
+            ::operator delete( new_slots );
+            throw;
+        }
+        std::memset( new_ctrl, ctrl_empty, count );
+        slots = new_slots;
+        ctrl = new_ctrl;
+        capacity = count;
+        growth_left = maxFill( count );
+    }
+
+    static void deallocate( value_type *slots, std::int8_t *ctrl )
+    {
+        ::operator delete( slots );
+        delete[] ctrl;
+    }
+
+    void deleteAll()
+    {
+        for( size_type i = 0; i < capacity && number_of_elements > 0; ++i )
+        {
+            if( isFull( ctrl[i] ) )
+            {
+                slots[i].~value_type();
+                --number_of_elements;
+            }
+        }
+        if( capacity > 0 )
+            std::memset( ctrl, ctrl_empty, capacity );
+        growth_left = maxFill( capacity );
+    }
+
+    // Mixed so that both the group index (H1) and the tag (H2) get well spread bits
+    static size_type hashOf( const key_type& key )
+    {
+        std::uint64_t hash = std::hash<key_type>()( key );
+        hash ^= hash >> 32;
+        hash *= 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 29;
+        return static_cast<size_type>( hash );
+    }
+
+    static std::int8_t tagOf( size_type hash )
+    {
+        return static_cast<std::int8_t>( hash & 0x7F );
+    }
+
+    size_type firstGroupOf( size_type hash ) const
+    {
+        return ( hash >> 7 ) & ( capacity / group_width - 1 );
+    }
+
+    // Groups are visited with triangular steps, which covers all of them for power of two counts
+    size_type findIndex( const key_type& key, size_type hash ) const
+    {
+        if( number_of_elements == 0 )
+            return capacity;
+
+        std::int8_t tag = tagOf( hash );
+        size_type group = firstGroupOf( hash );
+        for( size_type step = 1; ; ++step )
+        {
+            Group g( ctrl + group * group_width );
+            for( std::uint32_t mask = g.match( tag ); mask != 0; mask &= mask - 1 )
+            {
+                size_type index = group * group_width + lowestBit( mask );
+                if( slots[index].first == key )
+                    return index;
+            }
+
+            // Key would have been placed in this empty slot
+            if( g.matchEmpty() != 0 )
+                return capacity;
+
+            group = ( group + step ) & ( capacity / group_width - 1 );
+        }
+    }
+
+    size_type findInsertSlot( size_type hash ) const
+    {
+        size_type group = firstGroupOf( hash );
+        for( size_type step = 1; ; ++step )
+        {
+            std::uint32_t mask = Group( ctrl + group * group_width ).matchEmptyOrDeleted();
+            if( mask != 0 )
+                return group * group_width + lowestBit( mask );
+
+            group = ( group + step ) & ( capacity / group_width - 1 );
+        }
+    }
+
+    void setFull( size_type index, size_type hash )
+    {
+        if( ctrl[index] == ctrl_empty )
+            --growth_left;
+        ctrl[index] = tagOf( hash );
+        ++number_of_elements;
+    }
+
+    void rehashForInsert()
+    {
+        // Mostly tombstones - same capacity is enough to make room again
+        if( 2 * ( number_of_elements + 1 ) <= maxFill( capacity ) )
+        {
+            rehash( capacity );
+            return;
+        }
+
+        // A low max_load_factor() may need more than doubling to leave room for one more.
+        // A moved-from map has no table at all and starts from one group.
+        size_type new_capacity = roundCapacity( 2 * capacity );
+        while( maxFill( new_capacity ) <= number_of_elements )
+            new_capacity *= 2;
+        rehash( new_capacity );
+    }
+
+    void eraseIndex( size_type index )
+    {
+        slots[index].~value_type();
+        --number_of_elements;
+
+        // If the group still has an empty slot, no probe sequence ever went past it,
+        // so the slot may become empty again. Otherwise it has to stay a tombstone.
+        if( Group( ctrl + ( index & ~( group_width - 1 ) ) ).matchEmpty() != 0 )
+        {
+            ctrl[index] = ctrl_empty;
+            ++growth_left;
+        }
+        else
+        {
+            ctrl[index] = ctrl_deleted;
+        }
+    }
+
+    size_type firstFull( size_type index ) const
+    {
+        while( index < capacity && !isFull( ctrl[index] ) )
+            ++index;
+        return index;
+    }
+};
+
+template <typename KeyType, typename ValueType>
+constexpr typename SwissHashMap<KeyType, ValueType>::size_type SwissHashMap<KeyType, ValueType>::group_width;
+template <typename KeyType, typename ValueType>
+constexpr std::int8_t SwissHashMap<KeyType, ValueType>::ctrl_empty;
+template <typename KeyType, typename ValueType>
+constexpr std::int8_t SwissHashMap<KeyType, ValueType>::ctrl_deleted;
+template <typename KeyType, typename ValueType>
+constexpr float SwissHashMap<KeyType, ValueType>::max_load_limit;
+
+template <typename KeyType, typename ValueType>
+class SwissHashMap<KeyType, ValueType>::ConstIterator
+{
+    const SwissHashMap *base_map;
+    size_type index;
+    friend class SwissHashMap;
+
+public:
+    using reference = typename SwissHashMap::const_reference;
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = typename SwissHashMap::value_type;
+    using pointer = const typename SwissHashMap::value_type*;
+
+    explicit ConstIterator( const SwissHashMap *base_map = nullptr, size_type index = 0 ) : base_map(base_map), index(index)
+    {}
+
+    ConstIterator( const ConstIterator& other ) : ConstIterator(other.base_map, other.index)
+    {}
+
+    ConstIterator& operator++()
+    {
+        if( base_map == nullptr || index >= base_map->capacity )
+            throw std::out_of_range("operator++");
+
+        index = base_map->firstFull( index + 1 );
+        return *this;
+    }
+
+    ConstIterator operator++(int)
+    {
+        auto result = *this;
+        ++(*this);
+        return result;
+    }
+
+    ConstIterator& operator--()
+    {
+        if( base_map == nullptr )
+            throw std::out_of_range("operator--");
+
+        size_type previous = index;
+        do
+        {
+            if( previous == 0 )
+                throw std::out_of_range("operator--");
+            --previous;
+        }
+        while( !isFull( base_map->ctrl[previous] ) );
+
+        index = previous;
+        return *this;
+    }
+
+    ConstIterator operator--(int)
+    {
+        auto result = *this;
+        --(*this);
+        return result;
+    }
+
+    reference operator*() const
+    {
+        if( base_map == nullptr || index >= base_map->capacity )
+            throw std::out_of_range("operator*");
+        return base_map->slots[index];
+    }
+
+    pointer operator->() const
+    {
+        return &this->operator*();
+    }
+
+    bool operator==( const ConstIterator& other ) const
+    {
+        return base_map == other.base_map && index == other.index;
+    }
+
+    bool operator!=( const ConstIterator& other ) const
+    {
+        return !(*this == other);
+    }
+};
+
+template <typename KeyType, typename ValueType>
+class SwissHashMap<KeyType, ValueType>::Iterator : public SwissHashMap<KeyType, ValueType>::ConstIterator
+{
+public:
+  using reference = typename SwissHashMap::reference;
+  using pointer = typename SwissHashMap::value_type*;
+
+  explicit Iterator(SwissHashMap *myMap = nullptr, size_type index = 0) : ConstIterator(myMap, index)
+  {}
+
+  Iterator(const ConstIterator& other)
+    : ConstIterator(other)
+  {}
+
+  Iterator& operator++()
+  {
+    ConstIterator::operator++();
+    return *this;
+  }
+
+  Iterator operator++(int)
+  {
+    auto result = *this;
+    ConstIterator::operator++();
+    return result;
+  }
+
+  Iterator& operator--()
+  {
+    ConstIterator::operator--();
+    return *this;
+  }
+
+  Iterator operator--(int)
+  {
+    auto result = *this;
+    ConstIterator::operator--();
+    return result;
+  }
+
+  pointer operator->() const
+  {
+    return &this->operator*();
+  }
+
+  reference operator*() const
+  {
+    // ugly cast, yet reduces code duplication.
+    return const_cast<reference>(ConstIterator::operator*());
+  }
+};
+
+}
+
+#endif /* AISDI_MAPS_SWISSHASHMAP_H */
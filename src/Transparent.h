@@ -0,0 +1,32 @@
+#ifndef AISDI_MAPS_TRANSPARENT_H
+#define AISDI_MAPS_TRANSPARENT_H
+
+#include <type_traits>
+
+namespace aisdi
+{
+
+namespace detail
+{
+
+template <typename>
+struct VoidType
+{
+    using type = void;
+};
+
+// Functor declaring 'is_transparent' accepts other types than the key type,
+// maps use it to look keys up without building a temporary key_type.
+template <typename Functor, typename = void>
+struct IsTransparent : std::false_type
+{};
+
+template <typename Functor>
+struct IsTransparent<Functor, typename VoidType<typename Functor::is_transparent>::type> : std::true_type
+{};
+
+}
+
+}
+
+#endif /* AISDI_MAPS_TRANSPARENT_H */
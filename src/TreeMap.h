@@ -1,17 +1,43 @@
 #ifndef AISDI_MAPS_TREEMAP_H
 #define AISDI_MAPS_TREEMAP_H
 
+#include <algorithm>
 #include <cstddef>
+#include <functional>
+#include <iterator>
 #include <initializer_list>
+#include <memory>
 #include <stdexcept>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 #include <queue>
+#include <vector>
+
+#include "EboStorage.h"
+#include "MovableNodePool.h"
+#include "Prefetch.h"
+#include "Transparent.h"
 
 namespace aisdi
 {
 
-template <typename KeyType, typename ValueType>
-class TreeMap
+// Comparators of keys for which a comparison costs almost nothing (std::less or std::greater on arithmetic,
+// enum and pointer keys) call Compare twice per node and stop at the matching node, which is faster for them
+// than the default descent making one Compare call per level down to a leaf. Specialize to change it.
+template <typename KeyType, typename Compare>
+struct CheapCompare
+: std::integral_constant<bool, (std::is_arithmetic<KeyType>::value || std::is_enum<KeyType>::value
+                                || std::is_pointer<KeyType>::value)
+                               && (std::is_same<Compare, std::less<KeyType>>::value
+                                   || std::is_same<Compare, std::greater<KeyType>>::value)>
+{};
+
+// Keys are ordered by Compare (a strict weak ordering), kept as an (empty) base
+template <typename KeyType, typename ValueType,
+          typename Compare = std::less<KeyType>,
+          typename Allocator = std::allocator<std::pair<const KeyType, ValueType>>>
+class TreeMap : private detail::EboStorage<Compare, 0>
 {
 public:
     using key_type = KeyType;
@@ -20,31 +46,70 @@ public:
     using size_type = std::size_t;
     using reference = value_type&;
     using const_reference = const value_type&;
+    using key_compare = Compare;
+    using allocator_type = Allocator;
 
     class ConstIterator;
     class Iterator;
     using iterator = Iterator;
     using const_iterator = ConstIterator;
 
-    TreeMap() : root(nullptr), size_of_tree(0) {}
+    // Pair of iterators usable in range-based for, as returned by range()
+    template <typename It>
+    class RangeView
+    {
+    public:
+        RangeView( It first, It last ) : first(first), last(last) {}
+
+        It begin() const
+        {
+            return first;
+        }
+
+        It end() const
+        {
+            return last;
+        }
+
+        bool empty() const
+        {
+            return first == last;
+        }
+
+    private:
+        It first;
+        It last;
+    };
+
+    TreeMap() : TreeMap( Compare() ) {}
+
+    explicit TreeMap( const Compare& compare, const Allocator& alloc = Allocator() )
+    : CompareStorage(compare), root(nullptr), rightmost(nullptr), appending(false), size_of_tree(0), pool( NodeAllocator(alloc) ) {}
+
+    explicit TreeMap( const Allocator& alloc ) : TreeMap( Compare(), alloc ) {}
 
-    TreeMap( std::initializer_list<value_type> list ) : TreeMap()
+    TreeMap( std::initializer_list<value_type> list, const Compare& compare = Compare(), const Allocator& alloc = Allocator() )
+    : TreeMap( compare, alloc )
     {
         for ( auto it = list.begin(); it != list.end(); ++it )
-            addNode( new Node(*it) );
+            addNode( pool.create(*it) );
     }
 
-    TreeMap( const TreeMap& other ) : TreeMap()
+    TreeMap( const TreeMap& other )
+    : TreeMap( other.compare(), std::allocator_traits<Allocator>::select_on_container_copy_construction( other.get_allocator() ) )
     {
         *this = other;
     }
 
-    TreeMap(TreeMap&& other) //: TreeMap()
+    TreeMap(TreeMap&& other) : CompareStorage( other.compare() ), pool( std::move(other.pool) ) //: TreeMap()
     {
         root = other.root;
+        rightmost = other.rightmost;
+        appending = other.appending;
         size_of_tree = other.size_of_tree;
 
         other.root = nullptr;
+        other.rightmost = nullptr;
         other.size_of_tree = 0;
     }
 
@@ -58,270 +123,1407 @@ public:
         if(this != &other)
         {
             deleteAll();
-            for( auto it = other.begin(); it != other.end(); ++it )
-                addNode( new Node(*it) );
+
+            if( AllocatorTraits::propagate_on_container_copy_assignment::value && pool.get_allocator() != other.pool.get_allocator() )
+                pool = Pool( other.pool.get_allocator() );
+
+            compare() = other.compare();
+            cloneTree( other.root );
+            rightmost = findLargest( root );
+            size_of_tree = other.size_of_tree;
+        }
+        return *this;
+    }
+
+    TreeMap& operator=( TreeMap&& other )
+    {
+        if(this != &other)
+        {
+            // Nodes of 'other' cannot be adopted, they belong to a different allocator
+            if( !AllocatorTraits::propagate_on_container_move_assignment::value && pool.get_allocator() != other.pool.get_allocator() )
+                return *this = other;
+
+            deleteAll();
+
+            compare() = other.compare();
+            root = other.root;
+            rightmost = other.rightmost;
+            appending = other.appending;
+            size_of_tree = other.size_of_tree;
+            pool = std::move( other.pool );
+
+            other.root = nullptr;
+            other.rightmost = nullptr;
+            other.size_of_tree = 0;
+        }
+        return *this;
+    }
+
+    // Map built from [first, last), which has to be sorted by key (std::invalid_argument otherwise).
+    // Of equal keys the first one is kept. The tree is built balanced in O(n), without rotations.
+    template <typename InputIt>
+    static TreeMap from_sorted( InputIt first, InputIt last, const Compare& compare = Compare(), const Allocator& alloc = Allocator() )
+    {
+        TreeMap map( compare, alloc );
+        map.assign_sorted( first, last );
+        return map;
+    }
+
+    // Replaces the contents with sorted [first, last), as from_sorted(). The old elements are dropped only
+    // once the new tree is built, so when it throws (unsorted input included) the map is left unchanged.
+    template <typename InputIt>
+    void assign_sorted( InputIt first, InputIt last )
+    {
+        std::vector<Node*> nodes;
+        createNodes( first, last, nodes );
+        buildFromNodes( nodes, true );
+    }
+
+    // Replaces the contents with [first, last) in any order. Elements are sorted (stably, so again the first
+    // of equal keys is kept) and the tree is built as by assign_sorted(), O(n log n) without rotations.
+    // The map is left unchanged when it throws.
+    template <typename InputIt>
+    void assign( InputIt first, InputIt last )
+    {
+        std::vector<Node*> nodes;
+        createNodes( first, last, nodes );
+
+        const Compare& less = compare();
+        try
+        {
+            std::stable_sort( nodes.begin(), nodes.end(),
+                              [&less]( const Node* a, const Node* b ) { return less( a->data.first, b->data.first ); } );
+        }
+        catch( ... )
+        {
+            destroyNodes( nodes );
+            throw;
+        }
+        buildFromNodes( nodes, false );
+    }
+
+    bool isEmpty() const
+    {
+        return (size_of_tree == 0);
+    }
+
+    mapped_type& operator[]( const key_type& key )
+    {
+        return try_emplace( key ).first->second;
+    }
+
+    mapped_type& operator[]( key_type&& key )
+    {
+        return try_emplace( std::move(key) ).first->second;
+    }
+
+    // Builds value_type from 'args' in a new node. The node is dropped if its key is already present.
+    template <typename... Args>
+    std::pair<iterator, bool> emplace( Args&&... args )
+    {
+        Node* node = pool.create( std::forward<Args>(args)... );
+        Node* parent;
+        bool as_left;
+        Node* existing;
+        try
+        {
+            existing = findInsertPosition( node->data.first, parent, as_left );
+        }
+        catch( ... )
+        {
+            pool.destroy( node );
+            throw;
+        }
+
+        if( existing != nullptr )
+        {
+            pool.destroy( node );
+            return std::make_pair( iterator( this, existing ), false );
+        }
+
+        insertAt( node, parent, as_left );
+        return std::make_pair( iterator( this, node ), true );
+    }
+
+    // Adds 'value' if its key is missing, returns the element with the key either way. When the key belongs
+    // right before 'hint' no descent is made: finding the place is amortised O(1) for an appending hint
+    // (end() with a key greater than all) and O(log n) for other hints, which need the predecessor of 'hint'.
+    // A wrong hint costs a normal descent. Updating subtree sizes and heights on the way back up is
+    // O(log n) either way, but compares no keys.
+    iterator insert( const_iterator hint, const value_type& value )
+    {
+        return insertHinted( hint, value );
+    }
+
+    iterator insert( const_iterator hint, value_type&& value )
+    {
+        return insertHinted( hint, std::move(value) );
+    }
+
+    // Adds the value built from 'args' only if 'key' is missing, otherwise nothing is constructed
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace( const key_type& key, Args&&... args )
+    {
+        return tryEmplace( key, std::forward<Args>(args)... );
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace( key_type&& key, Args&&... args )
+    {
+        return tryEmplace( std::move(key), std::forward<Args>(args)... );
+    }
+
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign( const key_type& key, M&& mapped )
+    {
+        return insertOrAssign( key, std::forward<M>(mapped) );
+    }
+
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign( key_type&& key, M&& mapped )
+    {
+        return insertOrAssign( std::move(key), std::forward<M>(mapped) );
+    }
+
+    const mapped_type& valueOf(const key_type& key) const
+    {
+        const Node* node = findNodeByKey( key );
+        if( node == nullptr )
+            throw std::out_of_range("valueOf() const");
+        return node->data.second;
+    }
+
+    mapped_type& valueOf(const key_type& key)
+    {
+        Node* node = findNodeByKey( key );
+        if( node == nullptr )
+            throw std::out_of_range("valueOf()");
+        return node->data.second;
+    }
+
+    const_iterator find(const key_type& key) const
+    {
+        return const_iterator( this, findNodeByKey(key) );
+    }
+
+    iterator find(const key_type& key)
+    {
+        return iterator( this, findNodeByKey(key) );
+    }
+
+    void remove(const key_type& key)
+    {
+        remove( find(key) );
+    }
+
+    // Looks up all keys of [first, last) and writes an iterator (end() if missing) for each to 'out'.
+    // Descents of a group of keys advance together one level at a time, with the next nodes prefetched,
+    // so the cache misses of different keys overlap. ForwardIt has to allow two passes.
+    template <typename ForwardIt, typename OutputIt>
+    OutputIt find_batch( ForwardIt first, ForwardIt last, OutputIt out )
+    {
+        Node* nodes[batch_size];
+
+        while( first != last )
+        {
+            size_type count = findGroup( first, last, nodes );
+            for( size_type i = 0; i < count; ++i )
+                *out++ = iterator( this, nodes[i] );
+        }
+        return out;
+    }
+
+    template <typename ForwardIt, typename OutputIt>
+    OutputIt find_batch( ForwardIt first, ForwardIt last, OutputIt out ) const
+    {
+        Node* nodes[batch_size];
+
+        while( first != last )
+        {
+            size_type count = findGroup( first, last, nodes );
+            for( size_type i = 0; i < count; ++i )
+                *out++ = const_iterator( this, nodes[i] );
+        }
+        return out;
+    }
+
+    // First element with key not less than 'key'
+    const_iterator lower_bound( const key_type& key ) const
+    {
+        return const_iterator( this, lowerBoundNode(key) );
+    }
+
+    iterator lower_bound( const key_type& key )
+    {
+        return iterator( this, lowerBoundNode(key) );
+    }
+
+    // First element with key greater than 'key'
+    const_iterator upper_bound( const key_type& key ) const
+    {
+        return const_iterator( this, upperBoundNode(key) );
+    }
+
+    iterator upper_bound( const key_type& key )
+    {
+        return iterator( this, upperBoundNode(key) );
+    }
+
+    // Elements with key equal to 'key' - at most one, the range is empty when it is missing
+    std::pair<const_iterator, const_iterator> equal_range( const key_type& key ) const
+    {
+        Node* lower = lowerBoundNode( key );
+        if( lower == nullptr || compare()( key, lower->data.first ) )
+            return std::make_pair( const_iterator( this, lower ), const_iterator( this, lower ) );
+        return std::make_pair( const_iterator( this, lower ), ++const_iterator( this, lower ) );
+    }
+
+    std::pair<iterator, iterator> equal_range( const key_type& key )
+    {
+        Node* lower = lowerBoundNode( key );
+        if( lower == nullptr || compare()( key, lower->data.first ) )
+            return std::make_pair( iterator( this, lower ), iterator( this, lower ) );
+        return std::make_pair( iterator( this, lower ), ++iterator( this, lower ) );
+    }
+
+    // Elements with keys in [lo, hi), found in O(log n) - iterating them costs O(k)
+    RangeView<const_iterator> range( const key_type& lo, const key_type& hi ) const
+    {
+        const_iterator first = lower_bound( lo );
+        if( !compare()( lo, hi ) )
+            return RangeView<const_iterator>( first, first );
+        return RangeView<const_iterator>( first, lower_bound( hi ) );
+    }
+
+    RangeView<iterator> range( const key_type& lo, const key_type& hi )
+    {
+        iterator first = lower_bound( lo );
+        if( !compare()( lo, hi ) )
+            return RangeView<iterator>( first, first );
+        return RangeView<iterator>( first, lower_bound( hi ) );
+    }
+
+    // Number of keys less than 'key', O(log n)
+    size_type rank( const key_type& key ) const
+    {
+        size_type result = 0;
+        for( Node* node = root; node != nullptr; )
+        {
+            if( compare()( node->data.first, key ) )
+            {
+                result += getSize( node->left ) + 1;
+                node = node->right;
+            }
+            else
+            {
+                node = node->left;
+            }
+        }
+        return result;
+    }
+
+    // Element with 'k' smaller keys before it (the k-th smallest, from 0), end() when k >= getSize()
+    const_iterator select( size_type k ) const
+    {
+        return const_iterator( this, selectNode( k ) );
+    }
+
+    iterator select( size_type k )
+    {
+        return iterator( this, selectNode( k ) );
+    }
+
+    // Number of keys in [lo, hi)
+    size_type count_range( const key_type& lo, const key_type& hi ) const
+    {
+        if( !compare()( lo, hi ) )
+            return 0;
+        return rank( hi ) - rank( lo );
+    }
+
+    // Heterogeneous lookup, available when Compare declares 'is_transparent'.
+    // 'key' is compared with stored keys directly, no key_type is constructed.
+    template <typename K, typename C = Compare, typename = typename std::enable_if<detail::IsTransparent<C>::value>::type>
+    const mapped_type& valueOf(const K& key) const
+    {
+        const Node* node = findNodeByKey( key );
+        if( node == nullptr )
+            throw std::out_of_range("valueOf() const");
+        return node->data.second;
+    }
+
+    template <typename K, typename C = Compare, typename = typename std::enable_if<detail::IsTransparent<C>::value>::type>
+    mapped_type& valueOf(const K& key)
+    {
+        Node* node = findNodeByKey( key );
+        if( node == nullptr )
+            throw std::out_of_range("valueOf()");
+        return node->data.second;
+    }
+
+    template <typename K, typename C = Compare, typename = typename std::enable_if<detail::IsTransparent<C>::value>::type>
+    const_iterator find(const K& key) const
+    {
+        return const_iterator( this, findNodeByKey(key) );
+    }
+
+    template <typename K, typename C = Compare, typename = typename std::enable_if<detail::IsTransparent<C>::value>::type>
+    iterator find(const K& key)
+    {
+        return iterator( this, findNodeByKey(key) );
+    }
+
+    // Iterators still go to remove(const_iterator)
+    template <typename K, typename C = Compare,
+              typename = typename std::enable_if<detail::IsTransparent<C>::value
+                                                 && !std::is_convertible<const K&, const_iterator>::value>::type>
+    void remove(const K& key)
+    {
+        remove( find(key) );
+    }
+
+    void remove( const const_iterator& it )
+    {
+        if( this != it.tree || it == end() )
+            throw std::out_of_range("remove()");
+
+        Node* node = it.node;
+        if( node == rightmost )
+            rightmost = predecessorOf( node );
+        detachNode( node );
+
+        pool.destroy( node );
+        --size_of_tree;
+        return;
+    }
+
+    // Removes elements with keys in [lo, hi) and returns their number. The tree is split around the range
+    // and the rest joined back, O(log n) plus destroying the removed nodes.
+    size_type erase_range( const key_type& lo, const key_type& hi )
+    {
+        if( !compare()( lo, hi ) )
+            return 0;
+
+        Node *lower, *rest, *middle, *upper;
+        splitTree( root, lo, lower, rest );
+        splitTree( rest, hi, middle, upper );
+        resetTree( joinTrees( lower, upper ) );
+
+        const size_type removed = getSize( middle );
+        deleteSubtree( middle );
+        return removed;
+    }
+
+    // Moves elements with keys not less than 'key' to the returned map, O(log n). No node is copied,
+    // those of the returned map stay in the memory of this one; a slab of it is given back
+    // once its last node, of either map, is destroyed.
+    TreeMap split( const key_type& key )
+    {
+        TreeMap upper( compare(), get_allocator() );
+
+        Node *lower_root, *upper_root;
+        splitTree( root, key, lower_root, upper_root );
+
+        resetTree( lower_root );
+        upper.resetTree( upper_root );
+        return upper;
+    }
+
+    // Moves all elements of 'other' here, 'other' is left empty. All keys of one map have to be less than
+    // all keys of the other (std::invalid_argument otherwise). O(log n), nodes of 'other' are linked in as they are.
+    // O(m) instead when allocators differ, then its elements are moved to new nodes of this map.
+    void join( TreeMap& other )
+    {
+        if( this == &other || other.root == nullptr )
+            return;
+
+        const bool other_after = root == nullptr
+                                 || compare()( findLargest(root)->data.first, findSmallest(other.root)->data.first );
+        if( !other_after && !compare()( findLargest(other.root)->data.first, findSmallest(root)->data.first ) )
+            throw std::invalid_argument("join()");
+
+        takeNodes( other );
+        resetTree( other_after ? joinTrees( root, other.root ) : joinTrees( other.root, root ) );
+        other.resetTree( nullptr );
+    }
+
+    void join( TreeMap&& other )
+    {
+        join( other );
+    }
+
+    // Set union: moves all elements of 'other' here, of equal keys the element of this map is kept.
+    // Both in-order sequences are merged and the tree is rebuilt balanced in O(n + m), reusing the nodes
+    // of 'other'. When 'other' is much smaller its nodes are inserted one by one instead, O(m log n).
+    void merge( TreeMap&& other )
+    {
+        if( this == &other || other.root == nullptr )
+            return;
+
+        takeNodes( other );
+        std::vector<Node*> donors = other.inOrderNodes();
+
+        if( fewLookupsCheaper( donors.size(), size_of_tree ) )
+        {
+            other.resetTree( nullptr );
+            for( Node* node : donors )
+                addNode( resetNode( node ) );
+            return;
+        }
+
+        std::vector<Node*> nodes = inOrderNodes();
+        std::vector<Node*> merged;
+        merged.reserve( nodes.size() + donors.size() );
+        other.resetTree( nullptr );
+
+        auto mine = nodes.begin();
+        auto theirs = donors.begin();
+        while( mine != nodes.end() && theirs != donors.end() )
+        {
+            if( compare()( (*mine)->data.first, (*theirs)->data.first ) )
+            {
+                merged.push_back( *mine++ );
+            }
+            else if( compare()( (*theirs)->data.first, (*mine)->data.first ) )
+            {
+                merged.push_back( *theirs++ );
+            }
+            else
+            {
+                pool.destroy( *theirs++ );
+                merged.push_back( *mine++ );
+            }
+        }
+        merged.insert( merged.end(), mine, nodes.end() );
+        merged.insert( merged.end(), theirs, donors.end() );
+
+        resetTree( buildBalanced( merged.data(), merged.size(), nullptr ) );
+    }
+
+    // Set intersection: keeps only elements whose keys are in 'other'. Linear merge of both sequences
+    // and a balanced rebuild, O(n + m), or a lookup in 'other' per element when this map is much smaller.
+    void intersect( const TreeMap& other )
+    {
+        if( this != &other )
+            retainNodes( other, true );
+    }
+
+    // Set difference: removes elements whose keys are in 'other'. Linear as intersect(),
+    // or removing the keys of 'other' one by one when it is much smaller.
+    void subtract( const TreeMap& other )
+    {
+        if( this == &other )
+        {
+            deleteAll();
+            return;
+        }
+
+        if( fewLookupsCheaper( other.size_of_tree, size_of_tree ) )
+        {
+            for( auto it = other.begin(); it != other.end(); ++it )
+            {
+                Node* node = findNodeByKey( it->first );
+                if( node != nullptr )
+                    remove( const_iterator( this, node ) );
+            }
+            return;
+        }
+
+        retainNodes( other, false );
+    }
+
+    size_type getSize() const
+    {
+        return size_of_tree;
+    }
+
+    bool operator==(const TreeMap& other) const
+    {
+        if( size_of_tree != other.size_of_tree )
+            return false;
+
+        for(auto it0 = begin(), it1 = other.begin(); it0 != end(); ++it0, ++it1)
+        {
+            if(*it0 != *it1)
+                return false;
+        }
+        return true;
+    }
+
+    bool operator!=(const TreeMap& other) const
+    {
+        return !(*this == other);
+    }
+
+    iterator begin()
+    {
+        return iterator(this, findSmallest(root));
+    }
+
+    iterator end()
+    {
+        return iterator(this, nullptr);
+    }
+
+    const_iterator cbegin() const
+    {
+        return const_iterator(this, findSmallest(root));
+    }
+
+    const_iterator cend() const
+    {
+        return const_iterator(this, nullptr);
+    }
+
+    const_iterator begin() const
+    {
+        return cbegin();
+    }
+
+    const_iterator end() const
+    {
+        return cend();
+    }
+
+    key_compare key_comp() const
+    {
+        return compare();
+    }
+
+    allocator_type get_allocator() const
+    {
+        return allocator_type( pool.get_allocator() );
+    }
+
+private:
+    struct Node
+    {
+        value_type data;
+        Node *left, *right, *parent;
+        int height; // Height of the subtree
+        size_type size; // Number of nodes in the subtree
+
+        // 'data' is built in place from 'args'
+        template <typename... Args>
+        explicit Node( Args&&... args )
+        : data( std::forward<Args>(args)... ), left(nullptr), right(nullptr), parent(nullptr), height(1), size(1) {}
+    };
+
+    // Descents find_batch() runs at once - about as many cache misses as a core keeps in flight.
+    // More of them only add bookkeeping while their prefetches wait in line.
+    static const size_type batch_size = 8;
+
+    using CompareStorage = detail::EboStorage<Compare, 0>;
+    using AllocatorTraits = std::allocator_traits<Allocator>;
+    using NodeAllocator = typename AllocatorTraits::template rebind_alloc<Node>;
+    using Pool = MovableNodePool<Node, NodeAllocator>;
+
+    using CheapLookup = std::integral_constant<bool, CheapCompare<key_type, Compare>::value>;
+
+    Node* root;
+    Node* rightmost; // Largest node
+    bool appending; // Last insert added the largest key, the next one is tried under 'rightmost' first
+    size_type size_of_tree;
+    Pool pool;
+
+    void deleteAll()
+    {
+        // Nodes are destroyed one by one even when that does nothing - their slabs count them,
+        // and some may belong to maps this one was split from or joined with
+        deleteSubtree( root );
+
+        root = nullptr;
+        rightmost = nullptr;
+        size_of_tree = 0;
+    }
+
+    // Takes 'new_root' (detached) as the whole tree, after operations rebuilding it at once
+    void resetTree( Node* new_root )
+    {
+        root = new_root;
+        rightmost = findLargest( root );
+        size_of_tree = getSize( root );
+    }
+
+    // Post-order walk over parent links - no recursion, no extra memory
+    void deleteSubtree( Node* node )
+    {
+        while( node != nullptr )
+        {
+            if( node->left != nullptr )
+            {
+                node = node->left;
+            }
+            else if( node->right != nullptr )
+            {
+                node = node->right;
+            }
+            else
+            {
+                Node* parent = node->parent;
+                if( parent != nullptr )
+                {
+                    if( parent->left == node )
+                        parent->left = nullptr;
+                    else
+                        parent->right = nullptr;
+                }
+
+                pool.destroy( node );
+                node = parent;
+            }
+        }
+    }
+
+    template <typename InputIt>
+    void createNodes( InputIt first, InputIt last, std::vector<Node*>& nodes )
+    {
+        try
+        {
+            reserveFor( nodes, first, last, typename std::iterator_traits<InputIt>::iterator_category() );
+            for( ; first != last; ++first )
+                nodes.push_back( pool.create( *first ) );
+        }
+        catch( ... )
+        {
+            destroyNodes( nodes );
+            throw;
+        }
+    }
+
+    template <typename InputIt>
+    void reserveFor( std::vector<Node*>&, InputIt, InputIt, std::input_iterator_tag )
+    {}
+
+    template <typename ForwardIt>
+    void reserveFor( std::vector<Node*>& nodes, ForwardIt first, ForwardIt last, std::forward_iterator_tag )
+    {
+        nodes.reserve( std::distance( first, last ) );
+    }
+
+    void destroyNodes( std::vector<Node*>& nodes )
+    {
+        for( Node* node : nodes )
+            pool.destroy( node );
+        nodes.clear();
+    }
+
+    // Replaces the tree with one of sorted 'nodes', dropping all but the first of equal keys.
+    // With 'check_order' a key less than the one before throws; then all 'nodes' are destroyed and the old tree is kept.
+    void buildFromNodes( std::vector<Node*>& nodes, bool check_order )
+    {
+        size_type kept = 0;
+        size_type i = 0;
+        try
+        {
+            for( ; i < nodes.size(); ++i )
+            {
+                if( kept != 0 && !compare()( nodes[kept - 1]->data.first, nodes[i]->data.first ) )
+                {
+                    if( check_order && compare()( nodes[i]->data.first, nodes[kept - 1]->data.first ) )
+                        throw std::invalid_argument("assign_sorted()");
+                    pool.destroy( nodes[i] );
+                    continue;
+                }
+                nodes[kept++] = nodes[i];
+            }
+        }
+        catch( ... )
+        {
+            // Slots between the kept nodes and the failing one were already moved or destroyed
+            nodes.erase( nodes.begin() + kept, nodes.begin() + i );
+            destroyNodes( nodes );
+            throw;
+        }
+
+        // New nodes share the pool with the old ones, so these cannot go by release()
+        deleteSubtree( root );
+        resetTree( buildBalanced( nodes.data(), kept, nullptr ) );
+    }
+
+    // Middle node becomes the root, halves become its subtrees - recursion depth is only log(count)
+    Node* buildBalanced( Node** nodes, size_type count, Node* parent )
+    {
+        if( count == 0 )
+            return nullptr;
+
+        const size_type middle = count / 2;
+        Node* node = nodes[middle];
+        node->parent = parent;
+        node->left = buildBalanced( nodes, middle, node );
+        node->right = buildBalanced( nodes + middle + 1, count - middle - 1, node );
+        updateNode( node );
+        return node;
+    }
+
+    // Copies the shape of the tree rooted at 'source' (heights included) - no comparisons, no rebalancing.
+    // Walks down and back up over parent links, every new node is linked at once so a throwing copy
+    // leaves a tree deleteAll() can clean up.
+    void cloneTree( const Node* source )
+    {
+        if( source == nullptr )
+            return;
+
+        try
+        {
+            root = cloneNode( source, nullptr );
+            Node* copy = root;
+
+            while( true )
+            {
+                if( source->left != nullptr && copy->left == nullptr )
+                {
+                    source = source->left;
+                    copy->left = cloneNode( source, copy );
+                    copy = copy->left;
+                }
+                else if( source->right != nullptr && copy->right == nullptr )
+                {
+                    source = source->right;
+                    copy->right = cloneNode( source, copy );
+                    copy = copy->right;
+                }
+                else if( copy == root )
+                {
+                    break;
+                }
+                else
+                {
+                    source = source->parent;
+                    copy = copy->parent;
+                }
+            }
+        }
+        catch( ... )
+        {
+            deleteAll();
+            throw;
+        }
+    }
+
+    Node* cloneNode( const Node* source, Node* parent )
+    {
+        Node* node = pool.create( source->data );
+        node->parent = parent;
+        node->height = source->height;
+        node->size = source->size;
+        return node;
+    }
+
+    const Compare& compare() const
+    {
+        return CompareStorage::get();
+    }
+
+    Compare& compare()
+    {
+        return CompareStorage::get();
+    }
+
+    // Single descent finds either the node or the place for it
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> tryEmplace( K&& key, Args&&... args )
+    {
+        Node* parent;
+        bool as_left;
+        Node* node = findInsertPosition( key, parent, as_left );
+
+        if( node != nullptr )
+            return std::make_pair( iterator( this, node ), false );
+
+        node = pool.create( std::piecewise_construct, std::forward_as_tuple( std::forward<K>(key) ),
+                            std::forward_as_tuple( std::forward<Args>(args)... ) );
+        insertAt( node, parent, as_left );
+        return std::make_pair( iterator( this, node ), true );
+    }
+
+    template <typename K, typename M>
+    std::pair<iterator, bool> insertOrAssign( K&& key, M&& mapped )
+    {
+        Node* parent;
+        bool as_left;
+        Node* node = findInsertPosition( key, parent, as_left );
+
+        if( node != nullptr )
+        {
+            node->data.second = std::forward<M>(mapped);
+            return std::make_pair( iterator( this, node ), false );
+        }
+
+        node = pool.create( std::forward<K>(key), std::forward<M>(mapped) );
+        insertAt( node, parent, as_left );
+        return std::make_pair( iterator( this, node ), true );
+    }
+
+    template <typename V>
+    iterator insertHinted( const const_iterator& hint, V&& value )
+    {
+        if( hint.tree != this )
+            throw std::out_of_range("insert()");
+
+        Node* existing = nullptr;
+        Node* parent;
+        bool as_left;
+        if( !positionBefore( hint.node, value.first, existing, parent, as_left ) )
+            existing = findInsertPosition( value.first, parent, as_left );
+
+        if( existing != nullptr )
+            return iterator( this, existing );
+
+        Node* node = pool.create( std::forward<V>(value) );
+        insertAt( node, parent, as_left );
+        return iterator( this, node );
+    }
+
+    // Place for 'key' between 'next' (nullptr for the end) and its predecessor, or the one of them holding 'key'
+    // as 'existing'. False when 'key' does not belong there. The predecessor of a leaf is usually its parent.
+    bool positionBefore( Node* next, const key_type& key, Node*& existing, Node*& parent, bool& as_left ) const
+    {
+        if( next != nullptr && !compare()( key, next->data.first ) )
+        {
+            if( compare()( next->data.first, key ) )
+                return false;
+            existing = next;
+            return true;
+        }
+
+        Node* previous = next == nullptr ? rightmost : predecessorOf( next );
+        if( previous != nullptr && !compare()( previous->data.first, key ) )
+        {
+            if( compare()( key, previous->data.first ) )
+                return false;
+            existing = previous;
+            return true;
+        }
+
+        // Free place is under 'next' on the left or else under the largest node of its left subtree
+        as_left = next != nullptr && next->left == nullptr;
+        parent = as_left ? next : previous;
+        return true;
+    }
+
+    // Adds a created node, it is destroyed if its key is already in the tree
+    void addNode( Node* node )
+    {
+        Node* parent;
+        bool as_left;
+
+        if( findInsertPosition( node->data.first, parent, as_left ) != nullptr )
+        {
+            pool.destroy( node );
+            return;
+        }
+
+        insertAt( node, parent, as_left );
+    }
+
+    // Returns the node holding 'key', otherwise nullptr and the leaf (and side) where a node with 'key' belongs.
+    // While keys come in ascending order, each one goes right under the rightmost node at once.
+    Node* findInsertPosition( const key_type& key, Node*& parent, bool& as_left ) const
+    {
+        if( appending && rightmost != nullptr && compare()( rightmost->data.first, key ) )
+        {
+            parent = rightmost;
+            as_left = false;
+            return nullptr;
+        }
+        return findInsertPosition( key, parent, as_left, CheapLookup() );
+    }
+
+    // Descends once with one comparison per level, equality is checked once at the end
+    Node* findInsertPosition( const key_type& key, Node*& parent, bool& as_left, std::false_type ) const
+    {
+        Node* node = root;
+        Node* candidate = nullptr; // Greatest node not greater than 'key'
+        parent = nullptr;
+        as_left = false;
+
+        while( node != nullptr )
+        {
+            parent = node;
+            as_left = compare()( key, node->data.first );
+            if( as_left )
+            {
+                node = node->left;
+            }
+            else
+            {
+                candidate = node;
+                node = node->right;
+            }
+        }
+
+        if( candidate != nullptr && !compare()( candidate->data.first, key ) )
+            return candidate;
+        return nullptr;
+    }
+
+    Node* findInsertPosition( const key_type& key, Node*& parent, bool& as_left, std::true_type ) const
+    {
+        Node* node = root;
+        parent = nullptr;
+        as_left = false;
+
+        while( node != nullptr )
+        {
+            const bool less = compare()( key, node->data.first );
+            const bool greater = compare()( node->data.first, key );
+            if( !less && !greater )
+                return node;
+            parent = node;
+            as_left = less;
+            node = greater ? node->right : node->left;
+        }
+        return nullptr;
+    }
+
+    void insertAt( Node* node, Node* parent, bool as_left )
+    {
+        node->parent = parent;
+        if( parent == nullptr )
+            root = node;
+        else if( as_left )
+            parent->left = node;
+        else
+            parent->right = node;
+
+        appending = parent == rightmost && !as_left;
+        if( appending )
+            rightmost = node;
+
+        balanceTree( parent );
+        ++size_of_tree;
+    }
+
+    // Unlinks 'node' from the tree and rebalances it, the node itself is left as it was
+    void detachNode( Node* node )
+    {
+        Node* lowest_changed; // Heights may differ from here up to the root
+
+        if( node->right == nullptr ) // One child - left child (or none)
+        {
+            lowest_changed = node->parent;
+            replace( node, node->left );
+        }
+        else if( node->left == nullptr ) // One child - right child
+        {
+            lowest_changed = node->parent;
+            replace( node, node->right );
+        }
+        else // Two children - successor takes the place of the node
+        {
+            Node* successor = findSmallest( node->right );
+
+            if( successor->parent == node )
+            {
+                lowest_changed = successor;
+            }
+            else
+            {
+                lowest_changed = successor->parent;
+                replace( successor, successor->right );
+                successor->right = node->right;
+                successor->right->parent = successor;
+            }
+
+            replace( node, successor );
+            successor->left = node->left;
+            successor->left->parent = successor;
+            successor->height = node->height;
+            successor->size = node->size;
+        }
+
+        balanceTree( lowest_changed );
+    }
+
+    // Tree of 'left', 'middle' and 'right' (detached, 'left' and 'right' may be empty), where keys of 'left'
+    // are less and keys of 'right' greater than the middle key. 'middle' is hung on the spine of the higher tree
+    // where the heights meet, O(height difference). Uses 'root' while rebalancing.
+    Node* joinTrees( Node* left, Node* middle, Node* right )
+    {
+        if( getHeight(left) > getHeight(right) + 1 )
+        {
+            Node* node = left;
+            while( getHeight(node->right) > getHeight(right) + 1 )
+                node = node->right;
+
+            linkChildren( middle, node->right, right );
+            node->right = middle;
+            middle->parent = node;
+
+            root = left;
+            balanceTree( node );
+            return root;
         }
-        return *this;
-    }
 
-    TreeMap& operator=( TreeMap&& other )
-    {
-        if(this != &other)
+        if( getHeight(right) > getHeight(left) + 1 )
         {
-            deleteAll();
+            Node* node = right;
+            while( getHeight(node->left) > getHeight(left) + 1 )
+                node = node->left;
 
-            root = other.root;
-            size_of_tree = other.size_of_tree;
+            linkChildren( middle, left, node->left );
+            node->left = middle;
+            middle->parent = node;
 
-            other.root = nullptr;
-            other.size_of_tree = 0;
+            root = right;
+            balanceTree( node );
+            return root;
         }
-        return *this;
+
+        linkChildren( middle, left, right );
+        middle->parent = nullptr;
+        return middle;
     }
 
-    bool isEmpty() const
+    // Same for trees without a middle node, the smallest node of 'right' is taken out to be one
+    Node* joinTrees( Node* left, Node* right )
     {
-        return (size_of_tree == 0);
+        if( left == nullptr )
+            return right;
+        if( right == nullptr )
+            return left;
+
+        root = right;
+        Node* middle = findSmallest( right );
+        detachNode( middle );
+        return joinTrees( left, middle, root );
     }
 
-    mapped_type& operator[]( const key_type& key )
+    void linkChildren( Node* node, Node* left, Node* right )
     {
-        // Find node by the key
-        Node* node = findNodeByKey( key );
+        node->left = left;
+        node->right = right;
+        if( left != nullptr )
+            left->parent = node;
+        if( right != nullptr )
+            right->parent = node;
+        updateNode( node );
+    }
 
-        // If it does not exist create it
+    // Splits the (detached) tree of 'node' into trees of keys less than 'key' and of the rest.
+    // Subtrees cut off on the way down are joined back on the way up, O(log n) in total.
+    void splitTree( Node* node, const key_type& key, Node*& lower, Node*& upper )
+    {
         if( node == nullptr )
         {
-            node = new Node( key, mapped_type() );
-            addNode( node );
+            lower = nullptr;
+            upper = nullptr;
+            return;
         }
-        return node->data.second; // return value
-    }
 
-    const mapped_type& valueOf(const key_type& key) const
-    {
-        const Node* node = findNodeByKey( key );
-        if( node == nullptr )
-            throw std::out_of_range("valueOf() const");
-        return node->data.second;
+        Node* left = node->left;
+        Node* right = node->right;
+        if( left != nullptr )
+            left->parent = nullptr;
+        if( right != nullptr )
+            right->parent = nullptr;
+
+        if( compare()( node->data.first, key ) )
+        {
+            Node* right_lower;
+            splitTree( right, key, right_lower, upper );
+            lower = joinTrees( left, node, right_lower );
+        }
+        else
+        {
+            Node* left_upper;
+            splitTree( left, key, lower, left_upper );
+            upper = joinTrees( left_upper, node, right );
+        }
     }
 
-    mapped_type& valueOf(const key_type& key)
+    // Makes nodes of 'other' destroyable by this pool - they already are when allocators are equal.
+    // Otherwise its elements are moved into new nodes of this pool (built into a tree of the same keys).
+    void takeNodes( TreeMap& other )
     {
-        Node* node = findNodeByKey( key );
-        if( node == nullptr )
-            throw std::out_of_range("valueOf()");
-        return node->data.second;
+        if( pool.get_allocator() == other.pool.get_allocator() )
+            return;
+
+        std::vector<Node*> nodes;
+        nodes.reserve( other.size_of_tree );
+        try
+        {
+            for( auto it = other.begin(); it != other.end(); ++it )
+                nodes.push_back( pool.create( std::move(*it) ) );
+        }
+        catch( ... )
+        {
+            destroyNodes( nodes );
+            throw;
+        }
+
+        other.deleteAll();
+        other.resetTree( buildBalanced( nodes.data(), nodes.size(), nullptr ) );
     }
 
-    const_iterator find(const key_type& key) const
+    // Whether 'few' descents in a tree of 'many' nodes cost less than a pass over both
+    static bool fewLookupsCheaper( size_type few, size_type many )
     {
-        return const_iterator( this, findNodeByKey(key) );
+        size_type depth = 1;
+        for( size_type count = many; count > 1; count /= 2 )
+            ++depth;
+        return few * depth < many;
     }
 
-    iterator find(const key_type& key)
+    std::vector<Node*> inOrderNodes() const
     {
-        return iterator( this, findNodeByKey(key) );
+        std::vector<Node*> nodes;
+        nodes.reserve( size_of_tree );
+        for( auto it = cbegin(); it != cend(); ++it )
+            nodes.push_back( it.node );
+        return nodes;
     }
 
-    void remove(const key_type& key)
+    // Prepares a node taken out of a tree to be inserted again
+    Node* resetNode( Node* node )
     {
-        remove( find(key) );
+        node->left = nullptr;
+        node->right = nullptr;
+        node->parent = nullptr;
+        node->height = 1;
+        node->size = 1;
+        return node;
     }
 
-    void remove( const const_iterator& it )
+    // Keeps the elements whose keys are (keep_common) or are not in 'other' and rebuilds the tree of them.
+    // Nothing is changed until all keys are checked.
+    void retainNodes( const TreeMap& other, bool keep_common )
     {
-        if( this != it.tree || it == end() )
-            throw std::out_of_range("remove()");
-
+        std::vector<Node*> nodes = inOrderNodes();
+        std::vector<Node*> dropped;
+        size_type kept = 0;
 
-        if( it.node->right == nullptr ) // One child - left child (or none)
-        {
-            replace( it.node, it.node->left );
-            balanceTree( it.node->left );
-        }
-        else if( it.node->left == nullptr ) // One child - right child
+        if( keep_common && fewLookupsCheaper( size_of_tree, other.size_of_tree ) )
         {
-            replace( it.node, it.node->right );
-            balanceTree( it.node->right );
+            for( Node* node : nodes )
+            {
+                if( other.findNodeByKey( node->data.first ) != nullptr )
+                    nodes[kept++] = node;
+                else
+                    dropped.push_back( node );
+            }
         }
-        else // Two children
+        else
         {
-            iterator tmp = it;
-            ++tmp;
-            Node* tmp_parent = tmp.node->parent;
-            replace( tmp.node, tmp.node->right );
-            replace( it.node, tmp.node );
-            balanceTree( tmp_parent );
-        }
+            auto it = other.cbegin();
+            for( Node* node : nodes )
+            {
+                while( it != other.cend() && compare()( it->first, node->data.first ) )
+                    ++it;
 
-        delete it.node;
-        --size_of_tree;
-        return;
-    }
+                const bool common = it != other.cend() && !compare()( node->data.first, it->first );
+                if( common == keep_common )
+                    nodes[kept++] = node;
+                else
+                    dropped.push_back( node );
+            }
+        }
 
-    size_type getSize() const
-    {
-        return size_of_tree;
+        for( Node* node : dropped )
+            pool.destroy( node );
+        resetTree( buildBalanced( nodes.data(), kept, nullptr ) );
     }
 
-    bool operator==(const TreeMap& other) const
+    // Puts 'y' (with its subtrees) in the place of 'x' under x's parent
+    void replace( Node* x, Node* y )
     {
-        if( size_of_tree != other.size_of_tree )
-            return false;
+        if( x->parent == nullptr )
+            root = y;
+        else if (x == x->parent->left)
+            x->parent->left = y;
+        else
+            x->parent->right = y;
 
-        for(auto it0 = begin(), it1 = other.begin(); it0 != end(); ++it0, ++it1)
-        {
-            if(*it0 != *it1)
-                return false;
-        }
-        return true;
+        if( y != nullptr )
+            y->parent = x->parent;
     }
 
-    bool operator!=(const TreeMap& other) const
+    template <typename K>
+    Node* findNodeByKey( const K& key ) const
     {
-        return !(*this == other);
+        return findNodeByKey( key, CheapLookup() );
     }
 
-    iterator begin()
+    // One comparison per level, equality is checked once at the end
+    template <typename K>
+    Node* findNodeByKey( const K& key, std::false_type ) const
     {
-        return iterator(this, findSmallest(root));
-    }
+        Node* candidate = lowerBoundNode( key, std::false_type() );
 
-    iterator end()
-    {
-        return iterator(this, nullptr);
+        if( candidate != nullptr && !compare()( key, candidate->data.first ) )
+            return candidate;
+        return nullptr;
     }
 
-    const_iterator cbegin() const
+    template <typename K>
+    Node* findNodeByKey( const K& key, std::true_type ) const
     {
-        return const_iterator(this, findSmallest(root));
+        Node* node = root;
+        while( node != nullptr )
+        {
+            const bool less = compare()( key, node->data.first );
+            const bool greater = compare()( node->data.first, key );
+            if( !less && !greater )
+                return node;
+            node = greater ? node->right : node->left;
+        }
+        return nullptr;
     }
 
-    const_iterator cend() const
+    // Smallest node not less than 'key'
+    template <typename K>
+    Node* lowerBoundNode( const K& key ) const
     {
-        return const_iterator(this, nullptr);
+        return lowerBoundNode( key, CheapLookup() );
     }
 
-    const_iterator begin() const
+    template <typename K>
+    Node* lowerBoundNode( const K& key, std::false_type ) const
     {
-        return cbegin();
-    }
+        Node* node = root;
+        Node* candidate = nullptr;
 
-    const_iterator end() const
-    {
-        return cend();
+        while( node != nullptr )
+        {
+            if( compare()( node->data.first, key ) )
+            {
+                node = node->right;
+            }
+            else
+            {
+                candidate = node;
+                node = node->left;
+            }
+        }
+        return candidate;
     }
 
-private:
-    struct Node
+    template <typename K>
+    Node* lowerBoundNode( const K& key, std::true_type ) const
     {
-        value_type data;
-        Node *left, *right, *parent;
-        int height; // Height of the subtree
-        Node( key_type key, mapped_type mapped )
-        : data( std::make_pair( key, mapped ) ), left(nullptr), right(nullptr), parent(nullptr), height(1) {}
-
-        Node( value_type it ) : Node( it.first,it.second ) {}
+        Node* node = root;
+        Node* candidate = nullptr;
 
-        ~Node() { delete left; delete right; }
-    };
-    Node* root;
-    size_type size_of_tree;
+        while( node != nullptr )
+        {
+            const bool less = compare()( key, node->data.first );
+            const bool greater = compare()( node->data.first, key );
+            if( !less && !greater )
+                return node;
+            candidate = greater ? candidate : node;
+            node = greater ? node->right : node->left;
+        }
+        return candidate;
+    }
 
-    void deleteAll()
+    // Smallest node greater than 'key'
+    template <typename K>
+    Node* upperBoundNode( const K& key ) const
     {
-        delete root;
-        root = nullptr;
-        size_of_tree = 0;
+        Node* node = root;
+        Node* candidate = nullptr;
+
+        while( node != nullptr )
+        {
+            if( compare()( key, node->data.first ) )
+            {
+                candidate = node;
+                node = node->left;
+            }
+            else
+            {
+                node = node->right;
+            }
+        }
+        return candidate;
     }
 
-    void addNode( Node* node )
+    // One comparison per level down to a leaf (as findNodeByKey with an expensive Compare), so the descents
+    // of up to batch_size keys from 'first' (which is advanced past them) advance in step
+    template <typename ForwardIt>
+    size_type findGroup( ForwardIt& first, ForwardIt last, Node** found ) const
     {
-        if( root == nullptr )
+        ForwardIt keys[batch_size];
+        Node* nodes[batch_size];
+        size_type count = 0;
+
+        for( ; first != last && count < batch_size; ++first, ++count )
         {
-            root = node;
-            ++size_of_tree;
-            return;
+            keys[count] = first;
+            nodes[count] = root;
+            found[count] = nullptr; // Candidate - smallest node not less than the key
         }
-        Node* tmp = root;
 
-        while( node->data.first != tmp->data.first )
+        for( bool descending = root != nullptr; descending; )
         {
-            if( node->data.first > tmp->data.first )
+            descending = false;
+            for( size_type i = 0; i < count; ++i )
             {
-                if( tmp->right == nullptr )
+                Node* node = nodes[i];
+                if( node == nullptr )
+                    continue;
+
+                if( compare()( node->data.first, *keys[i] ) )
                 {
-                    tmp->right = node;
-                    node->parent = tmp;
-                    break;
+                    node = node->right;
                 }
                 else
-                    tmp = tmp->right;
-            }
-            else //if (node->data.first < tmp->data.first)
-            {
-                if( tmp->left == nullptr )
                 {
-                    tmp->left = node;
-                    node->parent = tmp;
-                    break;
+                    found[i] = node;
+                    node = node->left;
                 }
-                else
-                    tmp = tmp->left;
-            }
-        }
 
-        if( node->data.first == tmp->data.first )
-        {
-            delete node;
-            return;
+                nodes[i] = node;
+                if( node != nullptr )
+                {
+                    detail::prefetch( node );
+                    descending = true;
+                }
+            }
         }
 
-        balanceTree( tmp );
+        for( size_type i = 0; i < count; ++i )
+            if( found[i] != nullptr && compare()( *keys[i], found[i]->data.first ) )
+                found[i] = nullptr;
 
-        size_of_tree++;
-        return;
+        return count;
     }
 
-    void replace( Node* x, Node* y )
+    Node* selectNode( size_type k ) const
     {
-        if( x->parent == nullptr )
-            root = y;
-        else if (x == x->parent->left)
-            x->parent->left = y;
-        else
-            x->parent->right = y;
-
-        if( y != nullptr )
+        Node* node = root;
+        while( node != nullptr )
         {
-            y->parent = x->parent;
-
-            if( x->right != nullptr && x->right != y )
-                y->right = x->right;
-
-            if( x->left != nullptr && x->left != y )
-                y->left = x->left;
+            const size_type left_size = getSize( node->left );
+            if( k < left_size )
+            {
+                node = node->left;
+            }
+            else if( k == left_size )
+            {
+                break;
+            }
+            else
+            {
+                k -= left_size + 1;
+                node = node->right;
+            }
         }
-
-        // Prepering 'x' to be deleted without deleting subtrees
-        x->parent = nullptr;
-        x->left   = nullptr;
-        x->right  = nullptr;
+        return node;
     }
 
-    Node* findNodeByKey( const key_type& key ) const
+    // Number of nodes before 'node' in order (getSize() for the end), walks up to the root
+    size_type positionOf( const Node* node ) const
     {
-        Node* node = root;
-        while( node != nullptr && key != node->data.first )
-        {
-            if( key > node->data.first )
-                node = node->right;
+        if( node == nullptr )
+            return size_of_tree;
 
-            else if( key < node->data.first )
-                node = node->left;
-        }
-        return node;
+        size_type position = getSize( node->left );
+        for( ; node->parent != nullptr; node = node->parent )
+            if( node->parent->right == node )
+                position += getSize( node->parent->left ) + 1;
+        return position;
     }
 
     Node* findSmallest( Node* node ) const
@@ -333,17 +1535,38 @@ private:
         return node;
     }
 
+    Node* findLargest( Node* node ) const
+    {
+        if( node != nullptr )
+            while( node->right != nullptr )
+                node = node->right;
+
+        return node;
+    }
+
+    Node* predecessorOf( Node* node ) const
+    {
+        if( node->left != nullptr )
+            return findLargest( node->left );
+
+        while( node->parent != nullptr && node->parent->left == node )
+            node = node->parent;
+        return node->parent;
+    }
+
     void balanceTree( Node* node )
     {
         while( node != nullptr )
         {
             if( isBalanced( node ) )
             {
-                updateHeight( node );
+                updateNode( node );
                 node = node->parent;
                 continue;
             }
 
+            // Rotations update the nodes they move, 'node' ends up below the new root of its subtree
+
             if( getHeight(node->left) <= getHeight(node->right) ) // Right subtree height is bigger
             {
                 if( getHeight(node->right->left) <= getHeight(node->right->right) )
@@ -353,7 +1576,6 @@ private:
                 else
                 {
                     rotateRight( node->right );
-                    updateHeight( node->right );
                     rotateLeft( node );
                 }
             }
@@ -366,13 +1588,11 @@ private:
                 else
                 {
                     rotateLeft( node->left );
-                    updateHeight( node->left );
                     rotateRight( node );
                 }
             }
 
-            updateHeight( node );
-            node = node->parent;
+            node = node->parent->parent;
         }
     }
 
@@ -384,9 +1604,16 @@ private:
         return node->height;
     }
 
-    void updateHeight( Node* node )
+    static size_type getSize( const Node* node )
+    {
+        return node == nullptr ? 0 : node->size;
+    }
+
+    // Height and size of the subtree, from its children
+    void updateNode( Node* node )
     {
         node->height = std::max( getHeight( node->left ), getHeight( node->right ) ) + 1;
+        node->size = getSize( node->left ) + getSize( node->right ) + 1;
     }
 
     bool isBalanced( Node* node ) const
@@ -426,8 +1653,8 @@ private:
         if( right_left != nullptr )
             right_left->parent = node;
 
-        //updateHeight( node );
-        //updateHeight( R );
+        updateNode( node );
+        updateNode( right );
     }
 
     void rotateRight( Node* node )
@@ -456,13 +1683,13 @@ private:
         if( left_right != nullptr )
             left_right->parent = node;
 
-        //updateHeight( node );
-        //updateHeight( L );
+        updateNode( node );
+        updateNode( left );
     }
 };
 
-template <typename KeyType, typename ValueType>
-class TreeMap<KeyType, ValueType>::ConstIterator
+template <typename KeyType, typename ValueType, typename Compare, typename Allocator>
+class TreeMap<KeyType, ValueType, Compare, Allocator>::ConstIterator
 {
     const TreeMap *tree;
     Node *node;
@@ -473,6 +1700,7 @@ public:
     using iterator_category = std::bidirectional_iterator_tag;
     using value_type = typename TreeMap::value_type;
     using pointer = const typename TreeMap::value_type*;
+    using difference_type = std::ptrdiff_t;
 
     explicit ConstIterator(const TreeMap *tree = nullptr, Node *node = nullptr) : tree(tree), node(node)
     {}
@@ -528,11 +1756,8 @@ public:
         // If node == nullptr we are in the end of tree
         if(node == nullptr)
         {
-            // We are searching for the highest value
-            node = tree->root;
-            while( node->right != nullptr )
-              node = node->right;
-
+            // The highest value is cached
+            node = tree->rightmost;
             return *this;
         }
 
@@ -573,6 +1798,37 @@ public:
         return tmp;
     }
 
+    // Moves by 'n' elements (back when negative) in O(log n), using the subtree sizes
+    ConstIterator& operator+=( difference_type n )
+    {
+        if( tree == nullptr )
+            throw std::out_of_range("operator+=");
+
+        const difference_type position = static_cast<difference_type>( tree->positionOf( node ) ) + n;
+        if( position < 0 || position > static_cast<difference_type>( tree->size_of_tree ) )
+            throw std::out_of_range("operator+=");
+
+        node = tree->selectNode( static_cast<size_type>( position ) );
+        return *this;
+    }
+
+    ConstIterator& operator-=( difference_type n )
+    {
+        return *this += -n;
+    }
+
+    ConstIterator operator+( difference_type n ) const
+    {
+        auto result = *this;
+        return result += n;
+    }
+
+    ConstIterator operator-( difference_type n ) const
+    {
+        auto result = *this;
+        return result -= n;
+    }
+
     pointer operator->() const
     {
         return &this->operator*();
@@ -597,8 +1853,8 @@ public:
 };
 
 
-template <typename KeyType, typename ValueType>
-class TreeMap<KeyType, ValueType>::Iterator : public TreeMap<KeyType, ValueType>::ConstIterator
+template <typename KeyType, typename ValueType, typename Compare, typename Allocator>
+class TreeMap<KeyType, ValueType, Compare, Allocator>::Iterator : public TreeMap<KeyType, ValueType, Compare, Allocator>::ConstIterator
 {
 public:
   using reference = typename TreeMap::reference;
@@ -634,6 +1890,30 @@ public:
     return result;
   }
 
+  Iterator& operator+=(typename ConstIterator::difference_type n)
+  {
+    ConstIterator::operator+=(n);
+    return *this;
+  }
+
+  Iterator& operator-=(typename ConstIterator::difference_type n)
+  {
+    ConstIterator::operator-=(n);
+    return *this;
+  }
+
+  Iterator operator+(typename ConstIterator::difference_type n) const
+  {
+    auto result = *this;
+    return result += n;
+  }
+
+  Iterator operator-(typename ConstIterator::difference_type n) const
+  {
+    auto result = *this;
+    return result -= n;
+  }
+
   pointer operator->() const
   {
     return &this->operator*();
@@ -1,6 +1,9 @@
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <cstdlib>
 #include <string>
+#include <vector>
 
 // For calculating elapsed time
 #include <chrono>
@@ -11,6 +14,8 @@
 
 #include "TreeMap.h"
 #include "HashMap.h"
+#include "FlatHashMap.h"
+#include "SwissHashMap.h"
 
 using ns = std::chrono::nanoseconds;
 using get_time = std::chrono::steady_clock;
@@ -18,17 +23,21 @@ using get_time = std::chrono::steady_clock;
 namespace
 {
 
-//template <typename K, typename V>
-//using Hash_Map = aisdi::HashMap<K, V>;
-//template <typename K, typename V>
-//using Tree_Map = aisdi::TreeMap<K, V>;
+using Hash_Map = aisdi::HashMap< int, int >;
+using Hash_Map_Pow2 = aisdi::HashMap< int, int, std::hash<int>, std::equal_to<int>, std::allocator<std::pair<const int, int>>, aisdi::PowerOfTwoBuckets >;
+using Flat_Map = aisdi::FlatHashMap< int, int >;
+using Swiss_Map = aisdi::SwissHashMap< int, int >;
+
+// Results of lookups are stored here, so the compiler cannot drop them
+volatile std::size_t sink;
 
 
 } // namespace
 
+template <typename Map>
 ns testAddRandomNumberHashMap( std::size_t number_of_elements, std::size_t size_of_table )
 {
-    aisdi::HashMap< int, int > x(size_of_table);
+    Map x(size_of_table);
 
     srand( 0 );
     auto start = get_time::now();
@@ -52,9 +61,10 @@ ns testAddRandomNumberTreeMap( std::size_t number_of_elements )
     return std::chrono::duration_cast<ns>(get_time::now() - start);
 }
 
+template <typename Map>
 ns testSearchRandomNumberHashMap( std::size_t number_of_elements, std::size_t size_of_table )
 {
-    aisdi::HashMap< int, int > x(size_of_table);
+    Map x(size_of_table);
 
     for( std::size_t i = 0; i < number_of_elements; ++i )
         x[i] = rand()%number_of_elements;
@@ -84,9 +94,10 @@ ns testSearchRandomNumberTreeMap( std::size_t number_of_elements )
     return std::chrono::duration_cast<ns>(get_time::now() - start);
 }
 
+template <typename Map>
 ns testIterationRandomNumberHashMap( std::size_t number_of_elements, std::size_t size_of_table )
 {
-    aisdi::HashMap< int, int > x(size_of_table);
+    Map x(size_of_table);
 
     for( std::size_t i = 0; i < number_of_elements; ++i )
         x[i] = rand()%number_of_elements;
@@ -114,9 +125,29 @@ ns testIterationRandomNumberTreeMap( std::size_t number_of_elements )
     return std::chrono::duration_cast<ns>(get_time::now() - start);
 }
 
+// Few elements in a big table, iteration should not depend on the number of buckets
+ns testIterationSparseHashMap( std::size_t number_of_elements, std::size_t size_of_table )
+{
+    Hash_Map x(size_of_table);
+
+    for( std::size_t i = 0; i < number_of_elements; ++i )
+        x[rand()] = i;
+
+    std::size_t visited = 0;
+    auto start = get_time::now();
+
+    for( auto i = x.begin(); i != x.end(); ++i )
+        ++visited;
+
+    auto stop = get_time::now();
+    sink = visited;
+    return std::chrono::duration_cast<ns>(stop - start);
+}
+
+template <typename Map>
 ns testDeleteAllHashMap( std::size_t number_of_elements, std::size_t size_of_table )
 {
-    aisdi::HashMap< int, int > *x = new aisdi::HashMap< int, int >(size_of_table);
+    Map *x = new Map(size_of_table);
 
     for( std::size_t i = 0; i < number_of_elements; ++i )
         (*x)[i] = rand()%number_of_elements;
@@ -144,9 +175,10 @@ ns testDeleteAllTreeMap( std::size_t number_of_elements )
     return std::chrono::duration_cast<ns>(get_time::now() - start);
 }
 
+template <typename Map>
 ns testAddingInOrderHashMap( std::size_t number_of_elements, std::size_t size_of_table )
 {
-    aisdi::HashMap< int, int > x(size_of_table);
+    Map x(size_of_table);
 
     srand( 0 );
     auto start = get_time::now();
@@ -170,6 +202,238 @@ ns testAddingInOrderTreeMap( std::size_t number_of_elements )
     return std::chrono::duration_cast<ns>(get_time::now() - start);
 }
 
+ns testBuildingSortedTreeMap( std::size_t number_of_elements )
+{
+    std::vector<std::pair<int, int>> items;
+    for( std::size_t i = 0; i < number_of_elements; ++i )
+        items.emplace_back( i, i );
+
+    auto start = get_time::now();
+
+    auto x = aisdi::TreeMap< int, int >::from_sorted( items.begin(), items.end() );
+
+    auto stop = get_time::now();
+    sink = x.getSize();
+    return std::chrono::duration_cast<ns>(stop - start);
+}
+
+// The oldest tenth of the keys is expired at once
+ns testExpiringRemoveTreeMap( std::size_t number_of_elements )
+{
+    aisdi::TreeMap< int, int > x;
+    for( std::size_t i = 0; i < number_of_elements; ++i )
+        x[i] = i;
+
+    auto start = get_time::now();
+
+    for( std::size_t i = 0; i < number_of_elements / 10; ++i )
+        x.remove( i );
+
+    auto stop = get_time::now();
+    sink = x.getSize();
+    return std::chrono::duration_cast<ns>(stop - start);
+}
+
+ns testExpiringEraseRangeTreeMap( std::size_t number_of_elements )
+{
+    aisdi::TreeMap< int, int > x;
+    for( std::size_t i = 0; i < number_of_elements; ++i )
+        x[i] = i;
+
+    auto start = get_time::now();
+
+    x.erase_range( 0, number_of_elements / 10 );
+
+    auto stop = get_time::now();
+    sink = x.getSize();
+    return std::chrono::duration_cast<ns>(stop - start);
+}
+
+// Keys share a long prefix, so every comparison has to look past it
+std::string makeStringKey( std::size_t i )
+{
+    return "some/common/path/prefix/" + std::to_string( i );
+}
+
+ns testSearchRandomStringHashMap( std::size_t number_of_elements, std::size_t size_of_table )
+{
+    aisdi::HashMap< std::string, int > x(size_of_table);
+
+    for( std::size_t i = 0; i < number_of_elements; ++i )
+        x[makeStringKey(i)] = i;
+
+    std::vector<std::string> keys;
+    srand( 0 );
+    for( std::size_t i = 0; i < number_of_elements; ++i )
+        keys.push_back( makeStringKey( rand()%number_of_elements ) );
+
+    std::size_t found = 0;
+    auto start = get_time::now();
+
+    for( std::size_t i = 0; i < number_of_elements; ++i )
+        found += ( x.find( keys[i] ) != x.end() );
+
+    auto stop = get_time::now();
+    sink = found;
+    return std::chrono::duration_cast<ns>(stop - start);
+}
+
+ns testSearchRandomStringTreeMap( std::size_t number_of_elements )
+{
+    aisdi::TreeMap< std::string, int > x;
+
+    for( std::size_t i = 0; i < number_of_elements; ++i )
+        x[makeStringKey(i)] = i;
+
+    std::vector<std::string> keys;
+    srand( 0 );
+    for( std::size_t i = 0; i < number_of_elements; ++i )
+        keys.push_back( makeStringKey( rand()%number_of_elements ) );
+
+    std::size_t found = 0;
+    auto start = get_time::now();
+
+    for( std::size_t i = 0; i < number_of_elements; ++i )
+        found += ( x.find( keys[i] ) != x.end() );
+
+    auto stop = get_time::now();
+    sink = found;
+    return std::chrono::duration_cast<ns>(stop - start);
+}
+
+// Lookups of the same random keys, one find() after another
+ns testFindLoopHashMap( std::size_t number_of_elements, std::size_t size_of_table )
+{
+    Hash_Map x(size_of_table);
+
+    for( std::size_t i = 0; i < number_of_elements; ++i )
+        x[i] = i;
+
+    std::vector<int> keys;
+    srand( 0 );
+    for( std::size_t i = 0; i < number_of_elements; ++i )
+        keys.push_back( rand()%number_of_elements );
+
+    std::vector<Hash_Map::iterator> found( keys.size() );
+    auto start = get_time::now();
+
+    for( std::size_t i = 0; i < keys.size(); ++i )
+        found[i] = x.find( keys[i] );
+
+    auto stop = get_time::now();
+    sink = ( found.back() != x.end() );
+    return std::chrono::duration_cast<ns>(stop - start);
+}
+
+ns testFindBatchHashMap( std::size_t number_of_elements, std::size_t size_of_table )
+{
+    Hash_Map x(size_of_table);
+
+    for( std::size_t i = 0; i < number_of_elements; ++i )
+        x[i] = i;
+
+    std::vector<int> keys;
+    srand( 0 );
+    for( std::size_t i = 0; i < number_of_elements; ++i )
+        keys.push_back( rand()%number_of_elements );
+
+    std::vector<Hash_Map::iterator> found( keys.size() );
+    auto start = get_time::now();
+
+    x.find_batch( keys.begin(), keys.end(), found.begin() );
+
+    auto stop = get_time::now();
+    sink = ( found.back() != x.end() );
+    return std::chrono::duration_cast<ns>(stop - start);
+}
+
+// The same for TreeMap. With int keys find() stops at the matching node, so the batch is compared
+// with the fastest single lookup.
+ns testFindLoopTreeMap( std::size_t number_of_elements )
+{
+    using Map = aisdi::TreeMap< int, int >;
+    Map x;
+
+    for( std::size_t i = 0; i < number_of_elements; ++i )
+        x[i] = i;
+
+    std::vector<int> keys;
+    srand( 0 );
+    for( std::size_t i = 0; i < number_of_elements; ++i )
+        keys.push_back( rand()%number_of_elements );
+
+    std::vector<Map::iterator> found( keys.size() );
+    auto start = get_time::now();
+
+    for( std::size_t i = 0; i < keys.size(); ++i )
+        found[i] = x.find( keys[i] );
+
+    auto stop = get_time::now();
+    sink = ( found.back() != x.end() );
+    return std::chrono::duration_cast<ns>(stop - start);
+}
+
+ns testFindBatchTreeMap( std::size_t number_of_elements )
+{
+    using Map = aisdi::TreeMap< int, int >;
+    Map x;
+
+    for( std::size_t i = 0; i < number_of_elements; ++i )
+        x[i] = i;
+
+    std::vector<int> keys;
+    srand( 0 );
+    for( std::size_t i = 0; i < number_of_elements; ++i )
+        keys.push_back( rand()%number_of_elements );
+
+    std::vector<Map::iterator> found( keys.size() );
+    auto start = get_time::now();
+
+    x.find_batch( keys.begin(), keys.end(), found.begin() );
+
+    auto stop = get_time::now();
+    sink = ( found.back() != x.end() );
+    return std::chrono::duration_cast<ns>(stop - start);
+}
+
+// Lookups per second, as reported for the batched tests. A whole number, so printing it leaves the format of std::cout alone
+long long lookupsPerSecond( std::size_t lookups, ns time )
+{
+    return time.count() > 0 ? std::llround( lookups * 1e9 / time.count() ) : 0;
+}
+
+// All elements in one bucket. Values are strings, so every node has to be visited on teardown.
+ns testDeleteLongChainHashMap( std::size_t chain_length )
+{
+    using Map = aisdi::HashMap< int, std::string >;
+    Map *x = new Map(1);
+    x->max_load_factor( static_cast<float>(chain_length) + 1 );
+
+    for( std::size_t i = 0; i < chain_length; ++i )
+        (*x)[i] = "value";
+
+    auto start = get_time::now();
+
+    delete x;
+
+    return std::chrono::duration_cast<ns>(get_time::now() - start);
+}
+
+ns testDeleteDeepTreeMap( std::size_t number_of_elements )
+{
+    using Map = aisdi::TreeMap< int, std::string >;
+    Map *x = new Map;
+
+    for( std::size_t i = 0; i < number_of_elements; ++i )
+        (*x)[i] = "value";
+
+    auto start = get_time::now();
+
+    delete x;
+
+    return std::chrono::duration_cast<ns>(get_time::now() - start);
+}
+
 int main(int argc, char** argv)
 {
     const std::size_t number_of_elements    = argc > 1 ? std::atoll(argv[1]) : 100000;
@@ -180,10 +444,22 @@ int main(int argc, char** argv)
     /// TEST#1 ===========================================================================
     std::cout << "Test#1: adding random elements, size_of_table == " << size_of_table << " (for HashMap)\n";
 
-    auto diff = testAddRandomNumberHashMap( number_of_elements, size_of_table );
+    auto diff = testAddRandomNumberHashMap<Hash_Map>( number_of_elements, size_of_table );
 
     std::cout << "HashMap    :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff).count() << " ns\n";
 
+    auto diff5 = testAddRandomNumberHashMap<Hash_Map_Pow2>( number_of_elements, size_of_table );
+
+    std::cout << "HashMapPow2:" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff5).count() << " ns\n";
+
+    auto diff3 = testAddRandomNumberHashMap<Flat_Map>( number_of_elements, size_of_table );
+
+    std::cout << "FlatHashMap:" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff3).count() << " ns\n";
+
+    auto diff4 = testAddRandomNumberHashMap<Swiss_Map>( number_of_elements, size_of_table );
+
+    std::cout << "SwissMap   :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff4).count() << " ns\n";
+
     auto diff2 = testAddRandomNumberTreeMap( number_of_elements );
 
     std::cout << "TreeMap    :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff2).count() << " ns\n";
@@ -196,10 +472,22 @@ int main(int argc, char** argv)
 
     std::cout << "Test#2: searching for random elements, size_of_table == " << size_of_table << " (for HashMap)\n";
 
-    diff = testSearchRandomNumberHashMap( number_of_elements, size_of_table );
+    diff = testSearchRandomNumberHashMap<Hash_Map>( number_of_elements, size_of_table );
 
     std::cout << "HashMap    :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff).count() << " ns\n";
 
+    diff5 = testSearchRandomNumberHashMap<Hash_Map_Pow2>( number_of_elements, size_of_table );
+
+    std::cout << "HashMapPow2:" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff5).count() << " ns\n";
+
+    diff3 = testSearchRandomNumberHashMap<Flat_Map>( number_of_elements, size_of_table );
+
+    std::cout << "FlatHashMap:" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff3).count() << " ns\n";
+
+    diff4 = testSearchRandomNumberHashMap<Swiss_Map>( number_of_elements, size_of_table );
+
+    std::cout << "SwissMap   :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff4).count() << " ns\n";
+
     diff2 = testSearchRandomNumberTreeMap( number_of_elements );
 
     std::cout << "TreeMap    :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff2).count() << " ns\n";
@@ -210,10 +498,22 @@ int main(int argc, char** argv)
 
     std::cout << "Test#3: iterating from the begin to the end, size_of_table == " << size_of_table << " (for HashMap)\n";
 
-    diff = testIterationRandomNumberHashMap( number_of_elements, size_of_table );
+    diff = testIterationRandomNumberHashMap<Hash_Map>( number_of_elements, size_of_table );
 
     std::cout << "HashMap    :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff).count() << " ns\n";
 
+    diff5 = testIterationRandomNumberHashMap<Hash_Map_Pow2>( number_of_elements, size_of_table );
+
+    std::cout << "HashMapPow2:" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff5).count() << " ns\n";
+
+    diff3 = testIterationRandomNumberHashMap<Flat_Map>( number_of_elements, size_of_table );
+
+    std::cout << "FlatHashMap:" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff3).count() << " ns\n";
+
+    diff4 = testIterationRandomNumberHashMap<Swiss_Map>( number_of_elements, size_of_table );
+
+    std::cout << "SwissMap   :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff4).count() << " ns\n";
+
     diff2 = testIterationRandomNumberTreeMap( number_of_elements );
 
     std::cout << "TreeMap    :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff2).count() << " ns\n";
@@ -224,10 +524,22 @@ int main(int argc, char** argv)
 
     std::cout << "Test#4: deleting all elements, size_of_table == " << size_of_table << " (for HashMap)\n";
 
-    diff = testDeleteAllHashMap( number_of_elements, size_of_table );
+    diff = testDeleteAllHashMap<Hash_Map>( number_of_elements, size_of_table );
 
     std::cout << "HashMap    :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff).count() << " ns\n";
 
+    diff5 = testDeleteAllHashMap<Hash_Map_Pow2>( number_of_elements, size_of_table );
+
+    std::cout << "HashMapPow2:" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff5).count() << " ns\n";
+
+    diff3 = testDeleteAllHashMap<Flat_Map>( number_of_elements, size_of_table );
+
+    std::cout << "FlatHashMap:" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff3).count() << " ns\n";
+
+    diff4 = testDeleteAllHashMap<Swiss_Map>( number_of_elements, size_of_table );
+
+    std::cout << "SwissMap   :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff4).count() << " ns\n";
+
     diff2 = testDeleteAllTreeMap( number_of_elements );
 
     std::cout << "TreeMap    :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff2).count() << " ns\n";
@@ -238,16 +550,116 @@ int main(int argc, char** argv)
 
     std::cout << "Test#5: adding elements in order, size_of_table == " << size_of_table << " (for HashMap)\n";
 
-    diff = testAddingInOrderHashMap( number_of_elements, size_of_table );
+    diff = testAddingInOrderHashMap<Hash_Map>( number_of_elements, size_of_table );
 
     std::cout << "HashMap    :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff).count() << " ns\n";
 
+    diff5 = testAddingInOrderHashMap<Hash_Map_Pow2>( number_of_elements, size_of_table );
+
+    std::cout << "HashMapPow2:" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff5).count() << " ns\n";
+
+    diff3 = testAddingInOrderHashMap<Flat_Map>( number_of_elements, size_of_table );
+
+    std::cout << "FlatHashMap:" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff3).count() << " ns\n";
+
+    diff4 = testAddingInOrderHashMap<Swiss_Map>( number_of_elements, size_of_table );
+
+    std::cout << "SwissMap   :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff4).count() << " ns\n";
+
     diff2 = testAddingInOrderTreeMap( number_of_elements );
 
     std::cout << "TreeMap    :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff2).count() << " ns\n";
 
     std::cout << "Difference :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff-diff2).count() << " ns\n\n";
 
+    /// DELETING PATHOLOGICAL SHAPES
+
+    // Building a single chain is quadratic, so its length is capped
+    const std::size_t chain_length = std::min<std::size_t>( number_of_elements, 20000 );
+
+    std::cout << "Test#6: deleting one chain of " << chain_length << " elements (HashMap), "
+              << number_of_elements << " elements added in order (TreeMap)\n";
+
+    diff = testDeleteLongChainHashMap( chain_length );
+
+    std::cout << "HashMap    :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff).count() << " ns\n";
+
+    diff2 = testDeleteDeepTreeMap( number_of_elements );
+
+    std::cout << "TreeMap    :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff2).count() << " ns\n\n";
+
+    /// SEARCHING FOR RANDOM STRING KEYS
+
+    std::cout << "Test#7: searching for random string keys, size_of_table == " << size_of_table << " (for HashMap)\n";
+
+    diff = testSearchRandomStringHashMap( number_of_elements, size_of_table );
+
+    std::cout << "HashMap    :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff).count() << " ns\n";
+
+    diff2 = testSearchRandomStringTreeMap( number_of_elements );
+
+    std::cout << "TreeMap    :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff2).count() << " ns\n";
+
+    std::cout << "Difference :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff-diff2).count() << " ns\n\n";
+
+    /// BATCHED SEARCHING
+
+    std::cout << "Test#8: searching for random elements one by one and in batches, size_of_table == " << size_of_table << " (HashMap)\n";
+
+    diff = testFindLoopHashMap( number_of_elements, size_of_table );
+
+    std::cout << "find()     :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff).count() << " ns\n";
+
+    diff2 = testFindBatchHashMap( number_of_elements, size_of_table );
+
+    std::cout << "find_batch :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff2).count() << " ns\n";
+
+    std::cout << "Difference :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff-diff2).count() << " ns\n\n";
+
+    std::cout << "Test#9: searching for random elements one by one and in batches (TreeMap)\n";
+
+    diff = testFindLoopTreeMap( number_of_elements );
+
+    std::cout << "find()     :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff).count() << " ns"
+              << std::setw(16) << lookupsPerSecond( number_of_elements, diff ) << " lookups/s\n";
+
+    diff2 = testFindBatchTreeMap( number_of_elements );
+
+    std::cout << "find_batch :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff2).count() << " ns"
+              << std::setw(16) << lookupsPerSecond( number_of_elements, diff2 ) << " lookups/s\n";
+
+    std::cout << "Difference :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff-diff2).count() << " ns\n\n";
+
+    std::cout << "Test#10: iterating " << number_of_elements / 1000 << " elements in a table of " << number_of_elements << " buckets (HashMap)\n";
+
+    diff = testIterationSparseHashMap( number_of_elements / 1000, number_of_elements );
+
+    std::cout << "HashMap    :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff).count() << " ns\n\n";
+
+    std::cout << "Test#11: building from elements in order, one by one and in bulk (TreeMap)\n";
+
+    diff = testAddingInOrderTreeMap( number_of_elements );
+
+    std::cout << "operator[] :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff).count() << " ns\n";
+
+    diff2 = testBuildingSortedTreeMap( number_of_elements );
+
+    std::cout << "from_sorted:" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff2).count() << " ns\n";
+
+    std::cout << "Difference :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff-diff2).count() << " ns\n\n";
+
+    std::cout << "Test#12: removing the lowest " << number_of_elements / 10 << " keys (TreeMap)\n";
+
+    diff = testExpiringRemoveTreeMap( number_of_elements );
+
+    std::cout << "remove()   :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff).count() << " ns\n";
+
+    diff2 = testExpiringEraseRangeTreeMap( number_of_elements );
+
+    std::cout << "erase_range:" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff2).count() << " ns\n";
+
+    std::cout << "Difference :" << std::setw(20) << std::right << std::chrono::duration_cast<ns>(diff-diff2).count() << " ns\n\n";
+
 
     return 0;
 }
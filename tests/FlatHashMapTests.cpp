@@ -0,0 +1,173 @@
+#include <FlatHashMap.h>
+
+#include <cstdint>
+#include <string>
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+// Operations shared with HashMap are tested in HashMapTests.cpp,
+// these cover what is specific to Robin Hood probing.
+
+namespace
+{
+
+// Every key lands in the same home slot
+struct CollidingKey
+{
+  int value;
+
+  bool operator==(const CollidingKey& other) const
+  {
+    return value == other.value;
+  }
+};
+
+} // namespace
+namespace std
+{
+template <> struct hash<CollidingKey>
+{
+    size_t operator()( const CollidingKey & ) const
+    {
+        return 42;
+    }
+};
+}
+
+template <typename K>
+using Map = aisdi::FlatHashMap<K, std::string>;
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+using std::begin;
+using std::end;
+
+BOOST_AUTO_TEST_SUITE(FlatHashMapTests)
+
+template <typename K>
+void thenMapContainsItems(const Map<K>& map,
+                          const std::map<K, std::string>& expected)
+{
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+
+  for (const auto& item : expected)
+  {
+    const auto it = map.find(item.first);
+    BOOST_REQUIRE_MESSAGE(it != end(map), "Missing required item with key: " << item.first);
+    BOOST_CHECK_MESSAGE(it->second == item.second,
+                        "Wrong value in map for key: " << item.first
+                        << " (expected: \"" << item.second
+                        << "\" got: \"" << it->second << "\")");
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSmallTable_WhenAddingManyItems_ThenTableGrowsAndKeepsAllItems,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(8);
+  std::map<K, std::string> expected;
+
+  for (int i = 0; i < 1000; ++i)
+  {
+    map[i] = std::to_string(i);
+    expected[i] = std::to_string(i);
+  }
+
+  BOOST_CHECK_LE(map.load_factor(), map.max_load_factor());
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenCopyOfMovedFromMap_WhenAddingManyItems_ThenAllItemsAreFound,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "a" }, { 2, "b" } };
+  Map<K> other{std::move(map)};
+  Map<K> copy{map};
+  std::map<K, std::string> expected;
+
+  BOOST_CHECK_GE(copy.bucket_count(), 8u);
+  for (int i = 0; i < 100; ++i)
+  {
+    copy[i] = std::to_string(i);
+    expected[i] = std::to_string(i);
+  }
+
+  thenMapContainsItems(copy, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenFullMap_WhenRemovingEveryOtherItem_ThenRemainingItemsAreFound,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+
+  for (int i = 0; i < 1000; ++i)
+    map[i * 64] = std::to_string(i);
+
+  for (int i = 0; i < 1000; ++i)
+  {
+    if (i % 2 == 0)
+      map.remove(i * 64);
+    else
+      expected[i * 64] = std::to_string(i);
+  }
+
+  std::size_t iterated = 0;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    ++iterated;
+
+  BOOST_CHECK_EQUAL(iterated, 500);
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE(GivenKeysSharingOneHash_WhenAddingAndRemovingThem_ThenAllAreFound)
+{
+  aisdi::FlatHashMap<CollidingKey, int> map;
+
+  for (int i = 0; i < 1000; ++i)
+    map[CollidingKey{ i }] = i;
+
+  BOOST_CHECK_EQUAL(map.getSize(), 1000);
+  for (int i = 0; i < 1000; ++i)
+    BOOST_CHECK_EQUAL(map.valueOf(CollidingKey{ i }), i);
+
+  for (int i = 0; i < 1000; i += 2)
+    map.remove(CollidingKey{ i });
+
+  BOOST_CHECK_EQUAL(map.getSize(), 500);
+  for (int i = 0; i < 1000; ++i)
+    BOOST_CHECK((map.find(CollidingKey{ i }) != map.end()) == (i % 2 == 1));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenRehashing_ThenAllItemsAreKept,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" } };
+
+  map.rehash(1000);
+  BOOST_CHECK_EQUAL(map.bucket_count(), 1024);
+
+  map.rehash(1);
+  BOOST_CHECK_EQUAL(map.bucket_count(), 8);
+
+  thenMapContainsItems(map, { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenSettingInvalidMaxLoadFactor_ThenExceptionIsThrown,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+
+  BOOST_CHECK_THROW(map.max_load_factor(0.0f), std::invalid_argument);
+  BOOST_CHECK_THROW(map.max_load_factor(1.0f), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
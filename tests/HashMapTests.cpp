@@ -1,8 +1,15 @@
 #include <HashMap.h>
+#include <FlatHashMap.h>
+#include <SwissHashMap.h>
 
+#include <cctype>
 #include <cstdint>
 #include <string>
+#include <tuple>
+#include <vector>
+#include <iterator>
 #include <map>
+#include <memory>
 
 #include <boost/test/unit_test.hpp>
 
@@ -114,6 +121,139 @@ std::ostream& operator<<(std::ostream& out, const OperationCountingObject& obj)
   return out << '<' << static_cast<int>(obj) << '>';
 }
 
+struct AllocationStats
+{
+  std::size_t allocations = 0;
+  std::size_t liveBytes = 0;
+};
+
+template <typename T>
+struct CountingAllocator
+{
+  using value_type = T;
+
+  explicit CountingAllocator(AllocationStats* stats_)
+    : stats(stats_)
+  {}
+
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>& other)
+    : stats(other.stats)
+  {}
+
+  T* allocate(std::size_t n)
+  {
+    ++stats->allocations;
+    stats->liveBytes += n * sizeof(T);
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, std::size_t n)
+  {
+    stats->liveBytes -= n * sizeof(T);
+    ::operator delete(p);
+  }
+
+  AllocationStats* stats;
+};
+
+template <typename T, typename U>
+bool operator==(const CountingAllocator<T>& a, const CountingAllocator<U>& b)
+{
+  return a.stats == b.stats;
+}
+
+template <typename T, typename U>
+bool operator!=(const CountingAllocator<T>& a, const CountingAllocator<U>& b)
+{
+  return !(a == b);
+}
+
+std::size_t hashCalls = 0;
+
+struct CaseInsensitiveHash
+{
+  std::size_t operator()(const std::string& key) const
+  {
+    std::string lower(key);
+    for (auto& c : lower)
+      c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return std::hash<std::string>()(lower);
+  }
+};
+
+struct CaseInsensitiveEqual
+{
+  bool operator()(const std::string& a, const std::string& b) const
+  {
+    if (a.size() != b.size())
+      return false;
+    for (std::size_t i = 0; i < a.size(); ++i)
+      if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i])))
+        return false;
+    return true;
+  }
+};
+
+struct SeededHash
+{
+  explicit SeededHash(std::size_t seed_ = 0)
+    : seed(seed_)
+  {}
+
+  std::size_t operator()(int key) const
+  {
+    return std::hash<int>()(key) ^ seed;
+  }
+
+  std::size_t seed;
+};
+
+// Refers to characters owned by someone else, like std::string_view
+struct KeyView
+{
+  const char* data;
+  std::size_t size;
+};
+
+std::size_t hashBytes(const char* data, std::size_t size)
+{
+  std::size_t hash = 14695981039346656037ull;
+  for (std::size_t i = 0; i < size; ++i)
+    hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ull;
+  return hash;
+}
+
+struct TransparentHash
+{
+  using is_transparent = void;
+
+  std::size_t operator()(const std::string& key) const
+  {
+    return hashBytes(key.data(), key.size());
+  }
+
+  std::size_t operator()(const KeyView& key) const
+  {
+    return hashBytes(key.data, key.size);
+  }
+};
+
+struct TransparentEqual
+{
+  using is_transparent = void;
+
+  bool operator()(const std::string& a, const std::string& b) const
+  {
+    return a == b;
+  }
+
+  bool operator()(const std::string& a, const KeyView& b) const
+  {
+    return a.compare(0, a.size(), b.data, b.size) == 0;
+  }
+};
+
 struct Fixture
 {
   Fixture()
@@ -129,6 +269,7 @@ template <> struct hash<OperationCountingObject>
 {
     size_t operator()( const OperationCountingObject & x ) const
     {
+        ++hashCalls;
         return hash<int>()( int(x) );
     }
 };
@@ -139,14 +280,25 @@ using Map = aisdi::HashMap<K, std::string>;
 
 using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t, OperationCountingObject>;
 
+// Every map engine has to pass the tests written for the original HashMap
+template <typename K>
+using FlatMap = aisdi::FlatHashMap<K, std::string>;
+
+template <typename K>
+using SwissMap = aisdi::SwissHashMap<K, std::string>;
+
+using TestedMapTypes = boost::mpl::list<Map<std::int32_t>, Map<std::uint64_t>, Map<OperationCountingObject>,
+                                        FlatMap<std::int32_t>, FlatMap<std::uint64_t>, FlatMap<OperationCountingObject>,
+                                        SwissMap<std::int32_t>, SwissMap<std::uint64_t>, SwissMap<OperationCountingObject>>;
+
 using std::begin;
 using std::end;
 
 BOOST_FIXTURE_TEST_SUITE(HashMapTests, Fixture)
 
-template <typename K>
-void thenMapContainsItems(const Map<K>& map,
-                          const std::map<K, std::string>& expected)
+template <typename M>
+void thenMapContainsItems(const M& map,
+                          const std::map<typename M::key_type, std::string>& expected)
 {
   BOOST_CHECK_EQUAL(map.getSize(), expected.size());
 
@@ -233,19 +385,20 @@ void thenAssignedObjectsCountWas<OperationCountingObject>(std::size_t count)
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCreatedWithDefaultConstructor_ThenItIsEmpty,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  const Map<K> map;
+  const M map;
 
   BOOST_CHECK(map.isEmpty());
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenAddingItem_ThenItIsNoLongerEmpty,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map;
+  using K = typename M::key_type;
+  M map;
 
   map[K{}] = std::string{};
 
@@ -253,31 +406,32 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenAddingItem_ThenItIsNoLongerEmpty
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenGettingIterators_ThenBeginEqualsEnd,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map;
+  M map;
 
   BOOST_CHECK(begin(map) == end(map));
-  BOOST_CHECK(const_cast<const Map<K>&>(map).begin() == map.end());
+  BOOST_CHECK(const_cast<const M&>(map).begin() == map.end());
   BOOST_CHECK(map.cbegin() == map.cend());
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenGettingIterator_ThenBeginIsNotEnd,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map;
+  using K = typename M::key_type;
+  M map;
   map[K{}] = std::string{};
 
   BOOST_CHECK(begin(map) != end(map));
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapWithOnePair_WhenIterating_ThenPairIsReturned,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map;
+  M map;
   map[753] = "Rome";
 
   auto it = map.begin();
@@ -288,10 +442,11 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapWithOnePair_WhenIterating_ThenPairIsReturn
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIterator_WhenPostIncrementing_ThenPreviousPositionIsReturned,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map;
+  using K = typename M::key_type;
+  M map;
   map[K{}] = std::string{};
 
   auto it = map.begin();
@@ -304,10 +459,11 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIterator_WhenPostIncrementing_ThenPreviousPos
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIterator_WhenPreIncrementing_ThenNewPositionIsReturned,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map;
+  using K = typename M::key_type;
+  M map;
   map[K{}] = std::string{};
 
   auto it = map.begin();
@@ -318,10 +474,10 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIterator_WhenPreIncrementing_ThenNewPositionI
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEndIterator_WhenIncrementing_ThenOperationThrows,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map;
+  M map;
 
   BOOST_CHECK_THROW(map.end()++, std::out_of_range);
   BOOST_CHECK_THROW(++(map.end()), std::out_of_range);
@@ -330,10 +486,10 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEndIterator_WhenIncrementing_ThenOperationThr
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEndIterator_WhenDecrementing_ThenIteratorPointsToLastItem,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map;
+  M map;
   map[1] = std::string{};
 
   auto it = map.end();
@@ -344,10 +500,10 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEndIterator_WhenDecrementing_ThenIteratorPoin
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIterator_WhenPreDecrementing_ThenNewIteratorValueIsReturned,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map;
+  M map;
   map[1] = std::string{};
 
   auto it = map.end();
@@ -358,10 +514,10 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIterator_WhenPreDecrementing_ThenNewIteratorV
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIterator_WhenPostDecrementing_ThenOldIteratorValueIsReturned,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map;
+  M map;
   map[1] = std::string{};
 
   auto it = map.end();
@@ -372,10 +528,10 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIterator_WhenPostDecrementing_ThenOldIterator
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenBeginIterator_WhenDecrementing_ThenOperationThrows,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map;
+  M map;
 
   BOOST_CHECK_THROW(map.begin()--, std::out_of_range);
   BOOST_CHECK_THROW(--(map.begin()), std::out_of_range);
@@ -384,10 +540,10 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenBeginIterator_WhenDecrementing_ThenOperationT
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEndIterator_WhenDereferencing_ThenOperationThrows,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map;
+  M map;
 
   BOOST_CHECK_THROW(*map.end(), std::out_of_range);
   BOOST_CHECK_THROW(*map.cend(), std::out_of_range);
@@ -396,10 +552,10 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEndIterator_WhenDereferencing_ThenOperationTh
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenConstIterator_WhenDereferencing_ThenItemIsReturned,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map;
+  M map;
   map[42] = "Answer";
 
   const auto it = map.cbegin();
@@ -409,10 +565,10 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenConstIterator_WhenDereferencing_ThenItemIsRet
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenSearchingForKey_ThenEndIsReturned,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  const Map<K> map;
+  const M map;
 
   const auto it = map.find(123);
 
@@ -420,10 +576,10 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenSearchingForKey_ThenEndIsReturne
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenSearchingForMissingKey_ThenEndIsReturned,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map;
+  M map;
   map[321] = "Not it";
 
   const auto it = map.find(123);
@@ -432,10 +588,10 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenSearchingForMissingKey_ThenEn
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenSearchingForKey_ThenItemIsReturned,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map;
+  M map;
   map[321] = "Not it";
   map[123] = "It!";
 
@@ -447,19 +603,19 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenSearchingForKey_ThenItemIsRet
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenGettingSize_ThenZeroIsReturnd,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  const Map<K> map;
+  const M map;
 
   BOOST_CHECK_EQUAL(map.getSize(), 0);
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenGettingSize_ThenItemCountIsReturnd,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map;
+  M map;
   map[1] = "1";
   map[2] = "1";
 
@@ -467,20 +623,20 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenGettingSize_ThenItemCountIsRe
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenInitializingFromListOfPairs_ThenAllItemsAreInMap,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  const M map = { { 42, "Alice" }, { 27, "Bob" } };
 
   thenMapContainsItems(map, { { 42, "Alice" }, { 27, "Bob" } });
 }
 
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIterator_WhenDereferencing_ThenItemCanBeChanged,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map = { { 42, "Chuck" }, { 27, "Bob" } };
+  M map = { { 42, "Chuck" }, { 27, "Bob" } };
 
   auto it = map.find(42);
   it->second = "Alice";
@@ -489,10 +645,10 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIterator_WhenDereferencing_ThenItemCanBeChang
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenAddingItem_ThenItemIsInMap,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map;
+  M map;
 
   map[42] = "Alice";
 
@@ -500,10 +656,10 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenAddingItem_ThenItemIsInMap,
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenChangingItem_ThenNewValueIsInMap,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map = { { 42, "Chuck" }, { 27, "Bob" } };
+  M map = { { 42, "Chuck" }, { 27, "Bob" } };
 
   map[42] = "Alice";
 
@@ -511,22 +667,22 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenChangingItem_ThenNewValueIsIn
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenCreatingCopy_ThenBothMapsAreEmpty,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  const Map<K> map;
-  const Map<K> other(map);
+  const M map;
+  const M other(map);
 
   BOOST_CHECK(other.isEmpty());
   BOOST_CHECK(map.isEmpty());
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenCreatingCopy_ThenAllItemsAreCopied,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
-  const Map<K> other{map};
+  M map = { { 753, "Rome" }, { 1789, "Paris" } };
+  const M other{map};
 
   map[1410] = "Grunwald";
 
@@ -535,23 +691,24 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenCreatingCopy_ThenAllItemsAreC
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenMovingToOther_ThenMapIsEmpty,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map;
-  Map<K> other{std::move(map)};
+  M map;
+  M other{std::move(map)};
 
   BOOST_CHECK(other.isEmpty());
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenMovingToOther_ThenAllItemsAreMoved,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
+  using K = typename M::key_type;
+  M map = { { 753, "Rome" }, { 1789, "Paris" } };
 
   OperationCountingObject::resetCounters();
-  Map<K> other{std::move(map)};
+  M other{std::move(map)};
 
   thenConstructedObjectsCountWas<K>(0);
   thenCopiedObjectsCountWas<K>(0);
@@ -561,12 +718,27 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenMovingToOther_ThenAllItemsAre
   thenMapContainsItems(other, { { 753, "Rome" }, { 1789, "Paris" } });
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMovedFromMap_WhenAddingItem_ThenItIsFound,
+                              M,
+                              TestedMapTypes)
+{
+  M map = { { 753, "Rome" }, { 1789, "Paris" } };
+  M other{std::move(map)};
+  M copy{map};
+
+  map[1410] = "Grunwald";
+  copy[1683] = "Vienna";
+
+  thenMapContainsItems(map, { { 1410, "Grunwald" } });
+  thenMapContainsItems(copy, { { 1683, "Vienna" } });
+}
+
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenAssigningToOther_ThenOtherMapIsEmpty,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  const Map<K> map;
-  Map<K> other = { { 42, "Alice" }, { 27, "Bob" } };
+  const M map;
+  M other = { { 42, "Alice" }, { 27, "Bob" } };
 
   other = map;
 
@@ -574,11 +746,11 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenAssigningToOther_ThenOtherMapIsE
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenAssigningToOther_ThenAllElementsAreCopied,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
-  Map<K> other = { { 42, "Alice" }, { 27, "Bob" } };
+  M map = { { 753, "Rome" }, { 1789, "Paris" } };
+  M other = { { 42, "Alice" }, { 27, "Bob" } };
 
   other = map;
   map[1410] = "Grunwald";
@@ -587,10 +759,10 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenAssigningToOther_ThenAllEleme
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenSelfAssigning_ThenNothingHappens,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map;
+  M map;
 
   map = map;
 
@@ -598,10 +770,10 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenSelfAssigning_ThenNothingHappens
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenSelfAssigning_ThenNothingHappens,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  M map = { { 42, "Alice" }, { 27, "Bob" } };
 
   map = map;
 
@@ -609,11 +781,11 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenSelfAssigning_ThenNothingHapp
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenMoveAssigning_ThenMapIsEmpty,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map;
-  Map<K> other = { { 42, "Alice" }, { 27, "Bob" } };
+  M map;
+  M other = { { 42, "Alice" }, { 27, "Bob" } };
 
   other = std::move(map);
 
@@ -621,11 +793,12 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenMoveAssigning_ThenMapIsEmpty,
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenMoveAssigning_ThenAllElementsAreMoved,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
-  Map<K> other = { { 42, "Alice" }, { 27, "Bob" } };
+  using K = typename M::key_type;
+  M map = { { 753, "Rome" }, { 1789, "Paris" } };
+  M other = { { 42, "Alice" }, { 27, "Bob" } };
 
   OperationCountingObject::resetCounters();
   other = std::move(map);
@@ -639,37 +812,37 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenMoveAssigning_ThenAllElements
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenReadingValueOfAnyKey_ThenExceptionIsThrown,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  const Map<K> map;
+  const M map;
 
   BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenReadingValueOfMissingKey_ThenExceptionIsThrown,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  const M map = { { 42, "Alice" }, { 27, "Bob" } };
 
   BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenReadingValueOfAKey_ThenValueIsReturned,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  const M map = { { 42, "Alice" }, { 27, "Bob" } };
 
   BOOST_CHECK_EQUAL(map.valueOf(42), "Alice");
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenChangingValueOfAKey_ThenValueIsChanged,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  M map = { { 42, "Alice" }, { 27, "Bob" } };
 
   map.valueOf(42) = "Chuck";
 
@@ -677,28 +850,28 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenChangingValueOfAKey_ThenValue
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenRemovingValueByKey_ThenExceptionIsThrown,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map;
+  M map;
 
   BOOST_CHECK_THROW(map.remove(1), std::out_of_range);
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenRemovingValueByWrongKey_ThenExceptionIsThrown,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  M map = { { 42, "Alice" }, { 27, "Bob" } };
 
   BOOST_CHECK_THROW(map.remove(1), std::out_of_range);
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenRemovingValueByKey_ThenItemIsRemoved,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  M map = { { 42, "Alice" }, { 27, "Bob" } };
 
   map.remove(27);
 
@@ -706,10 +879,10 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenRemovingValueByKey_ThenItemIs
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSingleItemMap_WhenRemovingValueByKey_ThenMapBecomesEmpty,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map = { { 27, "Bob" } };
+  M map = { { 27, "Bob" } };
 
   map.remove(27);
 
@@ -717,19 +890,19 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSingleItemMap_WhenRemovingValueByKey_ThenMapB
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenErasingEnd_ThenExceptionIsThrown,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  M map = { { 42, "Alice" }, { 27, "Bob" } };
 
   BOOST_CHECK_THROW(map.remove(end(map)), std::out_of_range);
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenRemovingItemByIterator_ThenItemIsRemoved,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  M map = { { 42, "Alice" }, { 27, "Bob" } };
 
   map.remove(map.find(42));
 
@@ -737,10 +910,10 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenRemovingItemByIterator_ThenIt
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSingleItemMap_WhenRemovingItemByIterator_ThenMapBecomesEmpty,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  Map<K> map = { { 42, "Alice" } };
+  M map = { { 42, "Alice" } };
 
   map.remove(map.find(42));
 
@@ -748,53 +921,816 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSingleItemMap_WhenRemovingItemByIterator_Then
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoEmptyMaps_WhenComparingThem_ThenTheyAreReportedAsEqual,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  const Map<K> map;
-  const Map<K> other;
+  const M map;
+  const M other;
 
   BOOST_CHECK(map == other);
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoEqualMaps_WhenComparingThem_ThenTheyAreReportedAsEqual,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
-  const Map<K> other = { { 42, "Alice" }, { 27, "Bob" } };
+  const M map = { { 42, "Alice" }, { 27, "Bob" } };
+  const M other = { { 42, "Alice" }, { 27, "Bob" } };
 
   BOOST_CHECK(map == other);
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoEquivalentMaps_WhenComparingThem_ThenTheyAreReportedAsEqual,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
-  const Map<K> other = { { 27, "Bob" }, { 42, "Alice" } };
+  const M map = { { 42, "Alice" }, { 27, "Bob" } };
+  const M other = { { 27, "Bob" }, { 42, "Alice" } };
 
   BOOST_CHECK(map == other);
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMapsWithDifferentValues_WhenComparingThem_ThenTheyAreNotEqual,
-                              K,
-                              TestedKeyTypes)
+                              M,
+                              TestedMapTypes)
 {
-  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
-  const Map<K> other = { { 27, "Alice" }, { 42, "Bob" } };
+  const M map = { { 42, "Alice" }, { 27, "Bob" } };
+  const M other = { { 27, "Alice" }, { 42, "Bob" } };
 
   BOOST_CHECK(map != other);
 }
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMapsWithDifferentKeys_WhenComparingThem_ThenTheyAreNotEqual,
+                              M,
+                              TestedMapTypes)
+{
+  const M map = { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" } };
+  const M other = { { 27, "Alice" }, { 42, "Bob" } };
+
+  BOOST_CHECK(map != other);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenRemovingWhileIterating_ThenEveryItemIsVisitedOnce,
+                              M,
+                              TestedMapTypes)
+{
+  using K = typename M::key_type;
+  M map(256);
+  std::map<K, std::string> expected;
+
+  for (int i = 0; i < 200; ++i)
+    map[i] = std::to_string(i);
+
+  std::map<K, int> visits;
+  for (auto it = map.begin(); it != map.end(); )
+  {
+    ++visits[it->first];
+    if (it->first % 3 == 0)
+      it = map.remove(it);
+    else
+    {
+      expected[it->first] = it->second;
+      ++it;
+    }
+  }
+
+  BOOST_CHECK_EQUAL(visits.size(), 200);
+  for (const auto& visit : visits)
+    BOOST_CHECK_EQUAL(visit.second, 1);
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSmallTable_WhenAddingManyItems_ThenTableGrowsAndKeepsAllItems,
                               K,
                               TestedKeyTypes)
 {
-  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" } };
-  const Map<K> other = { { 27, "Alice" }, { 42, "Bob" } };
+  Map<K> map(1);
+  std::map<K, std::string> expected;
 
-  BOOST_CHECK(map != other);
+  for (int i = 0; i < 100; ++i)
+  {
+    map[i] = std::to_string(i);
+    expected[i] = std::to_string(i);
+  }
+
+  BOOST_CHECK_GE(map.bucket_count(), 100u);
+  BOOST_CHECK_LE(map.load_factor(), map.max_load_factor());
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenReservedMap_WhenAddingReservedCount_ThenTableIsNotRehashed,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(1);
+  map.reserve(64);
+  const auto buckets = map.bucket_count();
+
+  for (int i = 0; i < 64; ++i)
+    map[i] = "x";
+
+  BOOST_CHECK_EQUAL(map.bucket_count(), buckets);
+  BOOST_CHECK_EQUAL(map.getSize(), 64);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenRehashing_ThenAllItemsAreKept,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" } };
+
+  map.rehash(1000);
+  BOOST_CHECK_EQUAL(map.bucket_count(), 1000);
+
+  map.rehash(1);
+  BOOST_CHECK_GE(map.bucket_count(), 3u);
+
+  thenMapContainsItems(map, { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenLoweringMaxLoadFactor_ThenTableGrows,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(4);
+  for (int i = 0; i < 4; ++i)
+    map[i] = "x";
+
+  map.max_load_factor(0.25f);
+
+  BOOST_CHECK_LE(map.load_factor(), 0.25f);
+  BOOST_CHECK_THROW(map.max_load_factor(0.0f), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapsWithDifferentTableSizes_WhenComparingThem_ThenTheyAreReportedAsEqual,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(1);
+  Map<K> other(1000);
+  for (int i = 0; i < 20; ++i)
+  {
+    map[i] = "x";
+    other[19 - i] = "x";
+  }
+
+  BOOST_CHECK(map == other);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIncrementalMap_WhenGrowing_ThenItemsAreReachableDuringMigration,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(4);
+  map.incremental_rehash(true, 1);
+  std::map<K, std::string> expected;
+
+  bool wasRehashing = false;
+  for (int i = 0; i < 200; ++i)
+  {
+    map[i] = std::to_string(i);
+    expected[i] = std::to_string(i);
+    wasRehashing = wasRehashing || map.rehashing();
+  }
+
+  std::size_t iterated = 0;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    ++iterated;
+
+  BOOST_CHECK(wasRehashing);
+  BOOST_CHECK_EQUAL(iterated, 200);
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIncrementalMapWithLowLoadFactor_WhenGrowingManyTimes_ThenItemsAreReachable,
+                              K,
+                              TestedKeyTypes)
+{
+  // Tables grow again after a quarter of the old bucket count, so each insertion migrates more than one bucket
+  Map<K> map(4);
+  map.max_load_factor(0.25f);
+  map.incremental_rehash(true, 1);
+  std::map<K, std::string> expected;
+
+  for (int i = 0; i < 2000; ++i)
+  {
+    map[i] = std::to_string(i);
+    expected[i] = std::to_string(i);
+    BOOST_REQUIRE(map.find(i / 2) != map.end());
+  }
+
+  std::size_t iterated = 0;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    ++iterated;
+
+  BOOST_CHECK_LE(map.load_factor(), 0.25f);
+  BOOST_CHECK_EQUAL(iterated, 2000);
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapDuringMigration_WhenRemovingAndCopying_ThenItemsAreConsistent,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(8);
+  map.incremental_rehash(true, 1);
+  for (int i = 0; i < 9; ++i)
+    map[i] = std::to_string(i);
+
+  BOOST_REQUIRE(map.rehashing());
+
+  map.remove(0);
+  map.remove(8);
+  const Map<K> copy(map);
+
+  std::map<K, std::string> expected;
+  for (int i = 1; i < 8; ++i)
+    expected[i] = std::to_string(i);
+
+  thenMapContainsItems(map, expected);
+  thenMapContainsItems(copy, expected);
+
+  auto it = map.end();
+  for (int i = 0; i < 7; ++i)
+    --it;
+  BOOST_CHECK(it == map.begin());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapDuringMigration_WhenDisablingIncrementalMode_ThenMigrationFinishes,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(8);
+  map.incremental_rehash(true, 1);
+  for (int i = 0; i < 9; ++i)
+    map[i] = "x";
+
+  map.incremental_rehash(false);
+
+  BOOST_CHECK(!map.rehashing());
+  BOOST_CHECK_EQUAL(map.bucket_count(), 16);
+  BOOST_CHECK_EQUAL(map.getSize(), 9);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapDuringMigration_WhenRemovingWhileIterating_ThenEveryItemIsVisitedOnce,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(4);
+  map.incremental_rehash(true, 1);
+  int count = 0;
+  for (; count < 100 || !map.rehashing(); ++count)
+    map[count] = std::to_string(count);
+
+  std::map<int, int> visits;
+  std::map<K, std::string> expected;
+  for (auto it = map.begin(); it != map.end();)
+  {
+    const int key = static_cast<int>(it->first);
+    ++visits[key];
+
+    auto next = it;
+    ++next;
+    if (key % 3 == 0)
+      map.remove(it);
+    else
+      expected[it->first] = it->second;
+    it = next;
+  }
+
+  BOOST_CHECK_EQUAL(visits.size(), static_cast<std::size_t>(count));
+  for (const auto& visit : visits)
+    BOOST_CHECK_EQUAL(visit.second, 1);
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMapOfTrivialItems_WhenClearedByAssignment_ThenItCanBeFilledAgain)
+{
+  aisdi::HashMap<int, int> map;
+  const aisdi::HashMap<int, int> empty;
+
+  for (int i = 0; i < 1000; ++i)
+    map[i] = i;
+  map = empty;
+  BOOST_CHECK(map.isEmpty());
+
+  for (int i = 0; i < 1000; ++i)
+    map[i] = 2 * i;
+  BOOST_CHECK_EQUAL(map.getSize(), 1000);
+  BOOST_CHECK_EQUAL(map.valueOf(999), 1998);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenRemovingAndAddingItemsRepeatedly_ThenAllItemsAreDestroyed,
+                              K,
+                              TestedKeyTypes)
+{
+  {
+    Map<K> map;
+    for (int round = 0; round < 3; ++round)
+    {
+      for (int i = 0; i < 100; ++i)
+        map[i] = std::to_string(round);
+      for (int i = 0; i < 100; i += 2)
+        map.remove(i);
+    }
+    BOOST_CHECK_EQUAL(map.getSize(), 50);
+    BOOST_CHECK_EQUAL(map.valueOf(1), "2");
+  }
+
+  thenDestroyedObjectsCountWas<K>(OperationCountingObject::constructedObjectsCount());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenFindingOrInsertingKey_ThenItIsInsertedWithDefaultValue,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+
+  auto result = map.find_or_insert(42);
+
+  BOOST_CHECK(result.second);
+  BOOST_CHECK(result.first == map.find(42));
+  BOOST_CHECK_EQUAL(result.first->first, 42);
+  BOOST_CHECK_EQUAL(result.first->second, "");
+  BOOST_CHECK_EQUAL(map.getSize(), 1);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapWithKey_WhenFindingOrInsertingIt_ThenExistingItemIsReturned,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+
+  auto result = map.find_or_insert(42);
+
+  BOOST_CHECK(!result.second);
+  BOOST_CHECK(result.first == map.find(42));
+  BOOST_CHECK_EQUAL(result.first->second, "Alice");
+  BOOST_CHECK_EQUAL(map.getSize(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMapAboutToGrow_WhenFindingOrInsertingKey_ThenIteratorPointsToNewItem)
+{
+  aisdi::HashMap<int, int> map(4);
+  for (int i = 0; i < 4; ++i)
+    map[i] = i;
+
+  auto result = map.find_or_insert(100);
+  result.first->second = 7;
+
+  BOOST_CHECK(result.second);
+  BOOST_CHECK_GT(map.bucket_count(), 4u);
+  BOOST_CHECK(result.first == map.find(100));
+  BOOST_CHECK_EQUAL(map.valueOf(100), 7);
+}
+
+BOOST_AUTO_TEST_CASE(GivenKeyTypes_WhenCheckingHashCachePolicy_ThenOnlyComplexKeysAreCached)
+{
+  BOOST_CHECK(!aisdi::CacheHashCode<int>::value);
+  BOOST_CHECK(!aisdi::CacheHashCode<const char*>::value);
+  BOOST_CHECK(aisdi::CacheHashCode<std::string>::value);
+  BOOST_CHECK(aisdi::CacheHashCode<OperationCountingObject>::value);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMapWithCachedHashes_WhenRehashing_ThenKeysAreNotHashedAgain)
+{
+  Map<OperationCountingObject> map(8);
+  for (int i = 0; i < 100; ++i)
+    map[i] = std::to_string(i);
+
+  hashCalls = 0;
+  map.rehash(1000);
+  map.remove(50);
+
+  BOOST_CHECK_EQUAL(hashCalls, 1u);
+  BOOST_CHECK_EQUAL(map.getSize(), 99);
+  BOOST_CHECK_EQUAL(map.valueOf(99), "99");
+}
+
+BOOST_AUTO_TEST_CASE(GivenPowerOfTwoPolicy_WhenCreatingMap_ThenBucketCountIsRoundedUp)
+{
+  using PowerOfTwoMap = aisdi::HashMap<int, int, std::hash<int>, std::equal_to<int>, std::allocator<std::pair<const int, int>>, aisdi::PowerOfTwoBuckets>;
+
+  PowerOfTwoMap map(1000);
+  BOOST_CHECK_EQUAL(map.bucket_count(), 1024u);
+
+  map.rehash(1500);
+  BOOST_CHECK_EQUAL(map.bucket_count(), 2048u);
+
+  for (int i = 0; i < 5000; ++i)
+    map[i * 1024] = i;
+
+  BOOST_CHECK_EQUAL(map.bucket_count(), 8192u);
+  BOOST_CHECK_EQUAL(map.getSize(), 5000);
+  for (int i = 0; i < 5000; ++i)
+    BOOST_CHECK_EQUAL(map.valueOf(i * 1024), i);
+}
+
+BOOST_AUTO_TEST_CASE(GivenStridedKeys_WhenMixingHashes_ThenLowBitsDiffer)
+{
+  std::map<std::size_t, int> buckets;
+  for (std::size_t i = 0; i < 64; ++i)
+    ++buckets[aisdi::PowerOfTwoBuckets::index(i * 1024, 64)];
+
+  BOOST_CHECK_GT(buckets.size(), 32u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenCaseInsensitiveMap_WhenAddingKeysDifferingInCase_ThenTheyAreTheSameItem)
+{
+  aisdi::HashMap<std::string, int, CaseInsensitiveHash, CaseInsensitiveEqual> map;
+
+  map["Alice"] = 1;
+  map["ALICE"] = 2;
+  map["bob"] = 3;
+
+  BOOST_CHECK_EQUAL(map.getSize(), 2);
+  BOOST_CHECK_EQUAL(map.valueOf("alice"), 2);
+  BOOST_CHECK(map.find("BOB") != map.end());
+  map.remove("Bob");
+  BOOST_CHECK_EQUAL(map.getSize(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMapWithStatefulHash_WhenCopying_ThenHashIsCopied)
+{
+  aisdi::HashMap<int, int, SeededHash> map(16, SeededHash(12345));
+  for (int i = 0; i < 100; ++i)
+    map[i] = i;
+
+  aisdi::HashMap<int, int, SeededHash> copy(map);
+  aisdi::HashMap<int, int, SeededHash> assigned;
+  assigned = map;
+
+  BOOST_CHECK_EQUAL(copy.hash_function().seed, 12345u);
+  BOOST_CHECK_EQUAL(assigned.hash_function().seed, 12345u);
+  BOOST_CHECK(copy == map);
+  BOOST_CHECK_EQUAL(assigned.valueOf(99), 99);
+}
+
+BOOST_AUTO_TEST_CASE(GivenStatelessHashAndKeyEqual_WhenCheckingMapSize_ThenTheyTakeNoSpace)
+{
+  using DefaultMap = aisdi::HashMap<std::string, int>;
+  using CaseInsensitiveMap = aisdi::HashMap<std::string, int, CaseInsensitiveHash, CaseInsensitiveEqual>;
+
+  BOOST_CHECK_EQUAL(sizeof(DefaultMap), sizeof(CaseInsensitiveMap));
+  BOOST_CHECK_LT(sizeof(aisdi::HashMap<int, int>), sizeof(aisdi::HashMap<int, int, SeededHash>));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenTryEmplacingMovedKey_ThenKeyIsMovedNotCopied,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  K key = 42;
+  K other = 27;
+
+  OperationCountingObject::resetCounters();
+  auto result = map.try_emplace(std::move(key), 3, 'a');
+  map[std::move(other)] = "Bob";
+
+  BOOST_CHECK(result.second);
+  BOOST_CHECK_EQUAL(result.first->second, "aaa");
+  BOOST_CHECK_EQUAL(map.valueOf(27), "Bob");
+  thenCopiedObjectsCountWas<K>(0);
+  thenMovedObjectsCountWas<K>(2);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapWithKey_WhenTryEmplacingIt_ThenNothingIsConstructed,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" } };
+  const K key = 42;
+
+  OperationCountingObject::resetCounters();
+  auto result = map.try_emplace(key, "Bob");
+
+  BOOST_CHECK(!result.second);
+  BOOST_CHECK_EQUAL(result.first->second, "Alice");
+  thenConstructedObjectsCountWas<K>(0);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenEmplacingItems_ThenOnlyNewKeysAreAdded,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+
+  auto first = map.emplace(42, "Alice");
+  auto second = map.emplace(42, "Bob");
+  auto third = map.emplace(std::piecewise_construct, std::forward_as_tuple(7), std::forward_as_tuple(2, 'x'));
+
+  BOOST_CHECK(first.second);
+  BOOST_CHECK(!second.second);
+  BOOST_CHECK(third.second);
+  BOOST_CHECK(second.first == first.first);
+  BOOST_CHECK_EQUAL(map.valueOf(42), "Alice");
+  BOOST_CHECK_EQUAL(map.valueOf(7), "xx");
+  BOOST_CHECK_EQUAL(map.getSize(), 2);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenInsertingOrAssigning_ThenValueIsAlwaysSet,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" } };
+
+  auto assigned = map.insert_or_assign(42, "Bob");
+  auto inserted = map.insert_or_assign(27, std::string("Eve"));
+
+  BOOST_CHECK(!assigned.second);
+  BOOST_CHECK(inserted.second);
+  BOOST_CHECK_EQUAL(map.valueOf(42), "Bob");
+  BOOST_CHECK_EQUAL(inserted.first->second, "Eve");
+  BOOST_CHECK_EQUAL(map.getSize(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMapOfMoveOnlyValues_WhenEmplacingAndAssigning_ThenValuesAreMovedIn)
+{
+  aisdi::HashMap<int, std::unique_ptr<int>> map;
+
+  map.try_emplace(1, new int(5));
+  map.emplace(2, std::unique_ptr<int>(new int(7)));
+  map.insert_or_assign(1, std::unique_ptr<int>(new int(6)));
+
+  BOOST_CHECK_EQUAL(*map.valueOf(1), 6);
+  BOOST_CHECK_EQUAL(*map.valueOf(2), 7);
+  BOOST_CHECK(map[3] == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(GivenTransparentMap_WhenLookingUpByKeyView_ThenItemsAreFoundWithoutKeyType)
+{
+  aisdi::HashMap<std::string, int, TransparentHash, TransparentEqual> map;
+  map["Alice"] = 1;
+  map["Bob"] = 2;
+  map["Eve"] = 3;
+
+  const char buffer[] = "Alice and Bob";
+  const KeyView alice = { buffer, 5 };
+  const KeyView bob = { buffer + 10, 3 };
+  const KeyView nobody = { buffer + 6, 3 };
+
+  BOOST_CHECK_EQUAL(map.find(bob)->second, 2);
+  BOOST_CHECK(map.find(nobody) == map.end());
+  BOOST_CHECK_EQUAL(map.valueOf(alice), 1);
+  BOOST_CHECK_THROW(map.valueOf(nobody), std::out_of_range);
+
+  map.remove(alice);
+  map.remove(map.find(bob));
+  BOOST_CHECK_EQUAL(map.getSize(), 1);
+  BOOST_CHECK_THROW(map.remove(nobody), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenFindingBatchOfKeys_ThenResultsMatchFind,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 100; i += 2)
+    map[i] = std::to_string(i);
+
+  std::vector<K> keys;
+  for (int i = 0; i < 70; ++i)
+    keys.push_back((i * 37) % 120);
+
+  std::vector<typename Map<K>::iterator> found;
+  map.find_batch(keys.begin(), keys.end(), std::back_inserter(found));
+
+  BOOST_REQUIRE_EQUAL(found.size(), keys.size());
+  for (std::size_t i = 0; i < keys.size(); ++i)
+    BOOST_CHECK(found[i] == map.find(keys[i]));
+}
+
+BOOST_AUTO_TEST_CASE(GivenMovedFromMap_WhenFindingBatchOfKeys_ThenNothingIsFound)
+{
+  aisdi::HashMap<int, int> map = { { 1, 1 }, { 2, 2 } };
+  aisdi::HashMap<int, int> other(std::move(map));
+  const aisdi::HashMap<int, int>& moved = map;
+
+  const int keys[] = { 1, 2, 3 };
+  std::vector<aisdi::HashMap<int, int>::const_iterator> found;
+  moved.find_batch(std::begin(keys), std::end(keys), std::back_inserter(found));
+
+  BOOST_REQUIRE_EQUAL(found.size(), 3u);
+  for (const auto& it : found)
+    BOOST_CHECK(it == moved.end());
+}
+
+BOOST_AUTO_TEST_CASE(GivenSparseTable_WhenIteratingBothWays_ThenAllItemsAreVisited)
+{
+  aisdi::HashMap<int, int> map(100000);
+  const int keys[] = { 0, 63, 64, 65, 127, 128, 4095, 50000, 99999 };
+  for (int key : keys)
+    map[key] = key;
+
+  std::vector<int> forward;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    forward.push_back(it->first);
+
+  std::vector<int> backward;
+  for (auto it = map.end(); it != map.begin();)
+    backward.push_back((--it)->first);
+
+  const std::vector<int> expected(std::begin(keys), std::end(keys));
+  BOOST_CHECK_EQUAL_COLLECTIONS(forward.begin(), forward.end(), expected.begin(), expected.end());
+  BOOST_CHECK_EQUAL_COLLECTIONS(backward.rbegin(), backward.rend(), expected.begin(), expected.end());
+
+  map.remove(0);
+  map.remove(99999);
+  BOOST_CHECK_EQUAL(map.begin()->first, 63);
+  BOOST_CHECK_EQUAL((--map.end())->first, 50000);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMapBeingMigrated_WhenIteratingBothWays_ThenAllItemsAreVisited)
+{
+  aisdi::HashMap<int, int> map(64);
+  map.incremental_rehash(true, 1);
+  for (int i = 0; i < 65; ++i)
+    map[i * 7] = i;
+  BOOST_REQUIRE(map.rehashing());
+
+  std::size_t forward = 0;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    ++forward;
+
+  std::size_t backward = 0;
+  for (auto it = map.end(); it != map.begin(); --it)
+    ++backward;
+
+  BOOST_CHECK_EQUAL(forward, 65u);
+  BOOST_CHECK_EQUAL(backward, 65u);
+}
+
+template <typename K>
+using LinkedMap = aisdi::LinkedHashMap<K, std::string>;
+
+template <typename K>
+std::vector<K> keysInOrder(const LinkedMap<K>& map)
+{
+  std::vector<K> keys;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    keys.push_back(it->first);
+  return keys;
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenLinkedMap_WhenIterating_ThenItemsComeInInsertionOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  LinkedMap<K> map;
+  const int keys[] = { 42, 7, 1000, 3, 27, 512 };
+  for (int key : keys)
+    map[K(key)] = "a";
+
+  const std::vector<K> expected(std::begin(keys), std::end(keys));
+  const auto forward = keysInOrder(map);
+  BOOST_CHECK_EQUAL_COLLECTIONS(forward.begin(), forward.end(), expected.begin(), expected.end());
+
+  std::vector<K> backward;
+  for (auto it = map.end(); it != map.begin();)
+    backward.push_back((--it)->first);
+  BOOST_CHECK_EQUAL_COLLECTIONS(backward.rbegin(), backward.rend(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenLinkedMap_WhenDecrementingBegin_ThenExceptionIsThrown,
+                              K,
+                              TestedKeyTypes)
+{
+  LinkedMap<K> map;
+  map[K(1)] = "a";
+
+  auto it = map.begin();
+  BOOST_CHECK_THROW(--it, std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenLinkedMap_WhenReaddingRemovedKey_ThenItMovesToTheEnd,
+                              K,
+                              TestedKeyTypes)
+{
+  LinkedMap<K> map = { { 1, "a" }, { 2, "b" }, { 3, "c" } };
+
+  map.remove(K(1));
+  map.remove(K(3));
+  map[K(1)] = "d";
+  map[K(2)] = "e";
+
+  const std::vector<K> expected = { K(2), K(1) };
+  const auto keys = keysInOrder(map);
+  BOOST_CHECK_EQUAL_COLLECTIONS(keys.begin(), keys.end(), expected.begin(), expected.end());
+  BOOST_CHECK_EQUAL(map.valueOf(K(1)), "d");
+  BOOST_CHECK_EQUAL(map.valueOf(K(2)), "e");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenLinkedMap_WhenGrowingManyTimes_ThenOrderIsKept,
+                              K,
+                              TestedKeyTypes)
+{
+  LinkedMap<K> map(2);
+  std::vector<K> expected;
+  for (int i = 0; i < 500; ++i)
+  {
+    const int key = (i * 7919) % 1009;
+    map[K(key)] = "a";
+    expected.push_back(K(key));
+  }
+
+  const auto keys = keysInOrder(map);
+  BOOST_CHECK_EQUAL_COLLECTIONS(keys.begin(), keys.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenLinkedMap_WhenCopying_ThenOrderAndItemsAreKept,
+                              K,
+                              TestedKeyTypes)
+{
+  LinkedMap<K> map;
+  for (int i = 20; i > 0; --i)
+    map[K(i * 3)] = std::to_string(i);
+  map.remove(K(30));
+
+  LinkedMap<K> other = { { 1, "x" } };
+  other = map;
+
+  BOOST_CHECK(other == map);
+  const auto keys = keysInOrder(map);
+  const auto copied = keysInOrder(other);
+  BOOST_CHECK_EQUAL_COLLECTIONS(copied.begin(), copied.end(), keys.begin(), keys.end());
+
+  other[K(30)] = "new";
+  BOOST_CHECK_EQUAL(keysInOrder(other).back(), K(30));
+  BOOST_CHECK(map.find(K(30)) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenLinkedMap_WhenCopying_ThenEveryItemIsCopiedOnce,
+                              K,
+                              TestedKeyTypes)
+{
+  LinkedMap<K> map;
+  for (int i = 0; i < 10; ++i)
+    map[K(i)] = "a";
+  OperationCountingObject::resetCounters();
+
+  LinkedMap<K> other(map);
+
+  BOOST_CHECK_EQUAL(other.getSize(), 10u);
+  thenCopiedObjectsCountWas<K>(10);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenLinkedMap_WhenClearedAndReused_ThenAllObjectsAreDestroyed,
+                              K,
+                              TestedKeyTypes)
+{
+  {
+    LinkedMap<K> map;
+    for (int i = 0; i < 10; ++i)
+      map[K(i)] = "a";
+
+    map = LinkedMap<K>();
+    BOOST_CHECK(map.isEmpty());
+    BOOST_CHECK(map.begin() == map.end());
+
+    map[K(5)] = "b";
+    map[K(4)] = "c";
+    const std::vector<K> expected = { K(5), K(4) };
+    const auto keys = keysInOrder(map);
+    BOOST_CHECK_EQUAL_COLLECTIONS(keys.begin(), keys.end(), expected.begin(), expected.end());
+  }
+
+  thenDestroyedObjectsCountWas<K>(OperationCountingObject::constructedObjectsCount());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMovedLinkedMap_WhenIterating_ThenOrderIsKept,
+                              K,
+                              TestedKeyTypes)
+{
+  LinkedMap<K> map = { { 3, "a" }, { 1, "b" }, { 2, "c" } };
+  LinkedMap<K> other(std::move(map));
+
+  const std::vector<K> expected = { K(3), K(1), K(2) };
+  const auto keys = keysInOrder(other);
+  BOOST_CHECK_EQUAL_COLLECTIONS(keys.begin(), keys.end(), expected.begin(), expected.end());
+  BOOST_CHECK(map.begin() == map.end());
+}
+
+BOOST_AUTO_TEST_CASE(GivenMapWithCustomAllocator_WhenAddingItems_ThenAllMemoryComesFromIt)
+{
+  using Allocator = CountingAllocator<std::pair<const int, std::string>>;
+  using AllocatedMap = aisdi::HashMap<int, std::string, std::hash<int>, std::equal_to<int>, Allocator>;
+  AllocationStats stats;
+  {
+    AllocatedMap map(16, Allocator(&stats));
+    for (int i = 0; i < 100; ++i)
+      map[i] = std::to_string(i);
+
+    BOOST_CHECK_GT(stats.allocations, 0u);
+
+    AllocatedMap copy(map);
+    AllocatedMap moved(std::move(map));
+    copy.remove(42);
+
+    BOOST_CHECK(copy.get_allocator() == moved.get_allocator());
+    BOOST_CHECK_EQUAL(copy.getSize(), 99);
+    BOOST_CHECK_EQUAL(moved.valueOf(42), "42");
+  }
+  BOOST_CHECK_EQUAL(stats.liveBytes, 0u);
 }
 
 // ConstIterator is tested via Iterator methods.
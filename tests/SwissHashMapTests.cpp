@@ -0,0 +1,116 @@
+#include <SwissHashMap.h>
+
+#include <cstdint>
+#include <string>
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+// Operations shared with HashMap are tested in HashMapTests.cpp,
+// these cover deleted-slot markers and rehashing them away in place.
+
+template <typename K>
+using Map = aisdi::SwissHashMap<K, std::string>;
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+using std::begin;
+using std::end;
+
+BOOST_AUTO_TEST_SUITE(SwissHashMapTests)
+
+template <typename K>
+void thenMapContainsItems(const Map<K>& map,
+                          const std::map<K, std::string>& expected)
+{
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+
+  for (const auto& item : expected)
+  {
+    const auto it = map.find(item.first);
+    BOOST_REQUIRE_MESSAGE(it != end(map), "Missing required item with key: " << item.first);
+    BOOST_CHECK_MESSAGE(it->second == item.second,
+                        "Wrong value in map for key: " << item.first
+                        << " (expected: \"" << item.second
+                        << "\" got: \"" << it->second << "\")");
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenFullMap_WhenRemovingEveryOtherItem_ThenRemainingItemsAreFound,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+
+  for (int i = 0; i < 1000; ++i)
+    map[i * 128] = std::to_string(i);
+
+  for (int i = 0; i < 1000; ++i)
+  {
+    if (i % 2 == 0)
+      map.remove(i * 128);
+    else
+      expected[i * 128] = std::to_string(i);
+  }
+
+  std::size_t iterated = 0;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    ++iterated;
+
+  BOOST_CHECK_EQUAL(iterated, 500);
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenRepeatedlyAddingAndRemovingItems_ThenTableDoesNotGrow,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(64);
+  for (int i = 0; i < 40; ++i)
+    map[i] = "x";
+
+  const auto buckets = map.bucket_count();
+  for (int i = 40; i < 10000; ++i)
+  {
+    map[i] = "x";
+    map.remove(i - 40);
+  }
+
+  BOOST_CHECK_EQUAL(map.bucket_count(), buckets);
+  BOOST_CHECK_EQUAL(map.getSize(), 40);
+  for (int i = 10000 - 40; i < 10000; ++i)
+    BOOST_CHECK(map.find(i) != map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenChangingMaxLoadFactor_ThenItStaysWithinGroupProbingLimit,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(16);
+  std::map<K, std::string> expected;
+  for (int i = 0; i < 14; ++i)
+  {
+    map[i] = std::to_string(i);
+    expected[i] = std::to_string(i);
+  }
+
+  map.max_load_factor(0.25f);
+  BOOST_CHECK_LE(map.load_factor(), 0.25f);
+
+  for (int i = 14; i < 200; ++i)
+  {
+    map[i] = std::to_string(i);
+    expected[i] = std::to_string(i);
+    BOOST_REQUIRE_LE(map.load_factor(), 0.25f);
+  }
+  thenMapContainsItems(map, expected);
+
+  map.max_load_factor(1.0f);
+  BOOST_CHECK_EQUAL(map.max_load_factor(), 0.875f);
+  BOOST_CHECK_THROW(map.max_load_factor(0.0f), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
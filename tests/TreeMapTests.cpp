@@ -1,8 +1,16 @@
 #include <TreeMap.h>
 
+#include <algorithm>
+#include <cctype>
 #include <cstdint>
+#include <functional>
 #include <string>
+#include <tuple>
+#include <iterator>
 #include <map>
+#include <memory>
+#include <set>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
@@ -114,6 +122,102 @@ std::ostream& operator<<(std::ostream& out, const OperationCountingObject& obj)
   return out << '<' << static_cast<int>(obj) << '>';
 }
 
+struct AllocationStats
+{
+  std::size_t allocations = 0;
+  std::size_t liveBytes = 0;
+};
+
+template <typename T>
+struct CountingAllocator
+{
+  using value_type = T;
+
+  explicit CountingAllocator(AllocationStats* stats_)
+    : stats(stats_)
+  {}
+
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>& other)
+    : stats(other.stats)
+  {}
+
+  T* allocate(std::size_t n)
+  {
+    ++stats->allocations;
+    stats->liveBytes += n * sizeof(T);
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, std::size_t n)
+  {
+    stats->liveBytes -= n * sizeof(T);
+    ::operator delete(p);
+  }
+
+  AllocationStats* stats;
+};
+
+template <typename T, typename U>
+bool operator==(const CountingAllocator<T>& a, const CountingAllocator<U>& b)
+{
+  return a.stats == b.stats;
+}
+
+template <typename T, typename U>
+bool operator!=(const CountingAllocator<T>& a, const CountingAllocator<U>& b)
+{
+  return !(a == b);
+}
+
+struct CaseInsensitiveLess
+{
+  bool operator()(const std::string& a, const std::string& b) const
+  {
+    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), [](char x, char y) {
+      return std::tolower(static_cast<unsigned char>(x)) < std::tolower(static_cast<unsigned char>(y));
+    });
+  }
+};
+
+std::size_t comparisons = 0;
+
+struct CountingLess
+{
+  bool operator()(int a, int b) const
+  {
+    ++comparisons;
+    return a < b;
+  }
+};
+
+// Refers to characters owned by someone else, like std::string_view
+struct KeyView
+{
+  const char* data;
+  std::size_t size;
+};
+
+struct TransparentLess
+{
+  using is_transparent = void;
+
+  bool operator()(const std::string& a, const std::string& b) const
+  {
+    return a < b;
+  }
+
+  bool operator()(const std::string& a, const KeyView& b) const
+  {
+    return a.compare(0, a.size(), b.data, b.size) < 0;
+  }
+
+  bool operator()(const KeyView& a, const std::string& b) const
+  {
+    return b.compare(0, b.size(), a.data, a.size) > 0;
+  }
+};
+
 struct Fixture
 {
   Fixture()
@@ -786,6 +890,1138 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMapsWithDifferentKeys_WhenComparingThem_Th
   BOOST_CHECK(map != other);
 }
 
+BOOST_AUTO_TEST_CASE(GivenMapOfTrivialItems_WhenClearedByAssignment_ThenItCanBeFilledAgain)
+{
+  aisdi::TreeMap<int, int> map;
+  const aisdi::TreeMap<int, int> empty;
+
+  for (int i = 0; i < 1000; ++i)
+    map[i] = i;
+  map = empty;
+  BOOST_CHECK(map.isEmpty());
+
+  for (int i = 0; i < 1000; ++i)
+    map[i] = 2 * i;
+  BOOST_CHECK_EQUAL(map.getSize(), 1000);
+  BOOST_CHECK_EQUAL(map.valueOf(999), 1998);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenRemovingAndAddingItemsRepeatedly_ThenAllItemsAreDestroyed,
+                              K,
+                              TestedKeyTypes)
+{
+  {
+    Map<K> map;
+    for (int round = 0; round < 3; ++round)
+    {
+      for (int i = 0; i < 100; ++i)
+        map[i] = std::to_string(round);
+      for (int i = 0; i < 100; i += 2)
+        map.remove(i);
+    }
+    BOOST_CHECK_EQUAL(map.getSize(), 50);
+    BOOST_CHECK_EQUAL(map.valueOf(1), "2");
+  }
+
+  thenDestroyedObjectsCountWas<K>(OperationCountingObject::constructedObjectsCount());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenRemovingItemsWithTwoChildren_ThenIterationStillVisitsTheRest,
+                              K,
+                              TestedKeyTypes)
+{
+  {
+    Map<K> map;
+    for (int i = 1; i <= 63; ++i)
+      map[i] = std::to_string(i);
+
+    for (int i = 4; i <= 60; i += 8)
+      map.remove(i);
+
+    std::vector<int> forward;
+    for (auto it = map.begin(); it != map.end(); ++it)
+      forward.push_back(static_cast<int>(it->first));
+
+    std::vector<int> expected;
+    for (int i = 1; i <= 63; ++i)
+      if (i % 8 != 4)
+        expected.push_back(i);
+    BOOST_CHECK_EQUAL_COLLECTIONS(forward.begin(), forward.end(), expected.begin(), expected.end());
+
+    std::vector<int> backward;
+    for (auto it = map.end(); it != map.begin();)
+      backward.push_back(static_cast<int>((--it)->first));
+    BOOST_CHECK_EQUAL_COLLECTIONS(backward.rbegin(), backward.rend(), expected.begin(), expected.end());
+  }
+
+  thenDestroyedObjectsCountWas<K>(OperationCountingObject::constructedObjectsCount());
+}
+
+BOOST_AUTO_TEST_CASE(GivenMapWithGreaterCompare_WhenIterating_ThenItemsAreInDescendingOrder)
+{
+  aisdi::TreeMap<int, std::string, std::greater<int>> map = { { 1, "a" }, { 3, "c" }, { 2, "b" } };
+  map[0] = "z";
+
+  std::vector<int> keys;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    keys.push_back(it->first);
+
+  const std::vector<int> expected = { 3, 2, 1, 0 };
+  BOOST_CHECK_EQUAL_COLLECTIONS(keys.begin(), keys.end(), expected.begin(), expected.end());
+  BOOST_CHECK_EQUAL(map.valueOf(2), "b");
+  BOOST_CHECK(map.find(5) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE(GivenCaseInsensitiveMap_WhenAddingKeysDifferingInCase_ThenTheyAreTheSameItem)
+{
+  aisdi::TreeMap<std::string, int, CaseInsensitiveLess> map;
+
+  map["Alice"] = 1;
+  map["ALICE"] = 2;
+  map["bob"] = 3;
+
+  BOOST_CHECK_EQUAL(map.getSize(), 2);
+  BOOST_CHECK_EQUAL(map.valueOf("alice"), 2);
+  BOOST_CHECK_EQUAL(map.begin()->first, "Alice");
+  map.remove("BOB");
+  BOOST_CHECK_EQUAL(map.getSize(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMap_WhenFindingOrAddingKey_ThenCompareIsCalledOncePerLevel)
+{
+  aisdi::TreeMap<int, int, CountingLess> map;
+  for (int i = 0; i < 1023; ++i)
+    map[i] = i;
+
+  // Height of an AVL tree with 1023 nodes is at most 14
+  comparisons = 0;
+  map.find(500);
+  BOOST_CHECK_LE(comparisons, 15u);
+
+  comparisons = 0;
+  map[2000] = 1;
+  BOOST_CHECK_LE(comparisons, 15u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenStatelessCompare_WhenCheckingMapSize_ThenItTakesNoSpace)
+{
+  BOOST_CHECK_EQUAL(sizeof(aisdi::TreeMap<std::string, int>), sizeof(aisdi::TreeMap<std::string, int, CaseInsensitiveLess>));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenTryEmplacingMovedKey_ThenKeyIsMovedNotCopied,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  K key = 42;
+  K other = 27;
+
+  OperationCountingObject::resetCounters();
+  auto result = map.try_emplace(std::move(key), 3, 'a');
+  map[std::move(other)] = "Bob";
+
+  BOOST_CHECK(result.second);
+  BOOST_CHECK_EQUAL(result.first->second, "aaa");
+  BOOST_CHECK_EQUAL(map.valueOf(27), "Bob");
+  thenCopiedObjectsCountWas<K>(0);
+  thenMovedObjectsCountWas<K>(2);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapWithKey_WhenTryEmplacingIt_ThenNothingIsConstructed,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" } };
+  const K key = 42;
+
+  OperationCountingObject::resetCounters();
+  auto result = map.try_emplace(key, "Bob");
+
+  BOOST_CHECK(!result.second);
+  BOOST_CHECK_EQUAL(result.first->second, "Alice");
+  thenConstructedObjectsCountWas<K>(0);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenEmplacingItems_ThenOnlyNewKeysAreAdded,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+
+  auto first = map.emplace(42, "Alice");
+  auto second = map.emplace(42, "Bob");
+  auto third = map.emplace(std::piecewise_construct, std::forward_as_tuple(7), std::forward_as_tuple(2, 'x'));
+
+  BOOST_CHECK(first.second);
+  BOOST_CHECK(!second.second);
+  BOOST_CHECK(third.second);
+  BOOST_CHECK(second.first == first.first);
+  BOOST_CHECK_EQUAL(map.valueOf(42), "Alice");
+  BOOST_CHECK_EQUAL(map.valueOf(7), "xx");
+  BOOST_CHECK_EQUAL(map.getSize(), 2);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenInsertingOrAssigning_ThenValueIsAlwaysSet,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" } };
+
+  auto assigned = map.insert_or_assign(42, "Bob");
+  auto inserted = map.insert_or_assign(27, std::string("Eve"));
+
+  BOOST_CHECK(!assigned.second);
+  BOOST_CHECK(inserted.second);
+  BOOST_CHECK_EQUAL(map.valueOf(42), "Bob");
+  BOOST_CHECK_EQUAL(inserted.first->second, "Eve");
+  BOOST_CHECK_EQUAL(map.getSize(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMapOfMoveOnlyValues_WhenEmplacingAndAssigning_ThenValuesAreMovedIn)
+{
+  aisdi::TreeMap<int, std::unique_ptr<int>> map;
+
+  map.try_emplace(1, new int(5));
+  map.emplace(2, std::unique_ptr<int>(new int(7)));
+  map.insert_or_assign(1, std::unique_ptr<int>(new int(6)));
+
+  BOOST_CHECK_EQUAL(*map.valueOf(1), 6);
+  BOOST_CHECK_EQUAL(*map.valueOf(2), 7);
+  BOOST_CHECK(map[3] == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(GivenTransparentMap_WhenLookingUpByKeyView_ThenItemsAreFoundWithoutKeyType)
+{
+  aisdi::TreeMap<std::string, int, TransparentLess> map;
+  map["Alice"] = 1;
+  map["Bob"] = 2;
+  map["Eve"] = 3;
+
+  const char buffer[] = "Alice and Bob";
+  const KeyView alice = { buffer, 5 };
+  const KeyView bob = { buffer + 10, 3 };
+  const KeyView nobody = { buffer + 6, 3 };
+
+  BOOST_CHECK_EQUAL(map.find(bob)->second, 2);
+  BOOST_CHECK(map.find(nobody) == map.end());
+  BOOST_CHECK_EQUAL(map.valueOf(alice), 1);
+  BOOST_CHECK_THROW(map.valueOf(nobody), std::out_of_range);
+
+  map.remove(alice);
+  map.remove(map.find(bob));
+  BOOST_CHECK_EQUAL(map.getSize(), 1);
+  BOOST_CHECK_THROW(map.remove(nobody), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenFindingBatchOfKeys_ThenResultsMatchFind,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 100; i += 2)
+    map[i] = std::to_string(i);
+
+  std::vector<K> keys;
+  for (int i = 0; i < 70; ++i)
+    keys.push_back((i * 37) % 120 - 10);
+
+  std::vector<typename Map<K>::iterator> found;
+  map.find_batch(keys.begin(), keys.end(), std::back_inserter(found));
+
+  BOOST_REQUIRE_EQUAL(found.size(), keys.size());
+  for (std::size_t i = 0; i < keys.size(); ++i)
+    BOOST_CHECK(found[i] == map.find(keys[i]));
+}
+
+BOOST_AUTO_TEST_CASE(GivenEmptyMap_WhenFindingBatchOfKeys_ThenNothingIsFound)
+{
+  const aisdi::TreeMap<int, int> map;
+
+  const int keys[] = { 1, 2, 3 };
+  std::vector<aisdi::TreeMap<int, int>::const_iterator> found;
+  map.find_batch(std::begin(keys), std::end(keys), std::back_inserter(found));
+
+  BOOST_REQUIRE_EQUAL(found.size(), 3u);
+  for (const auto& it : found)
+    BOOST_CHECK(it == map.end());
+}
+
+BOOST_AUTO_TEST_CASE(GivenMap_WhenCopying_ThenNoKeysAreCompared)
+{
+  aisdi::TreeMap<int, int, CountingLess> map;
+  for (int i = 0; i < 1000; ++i)
+    map[(i * 7919) % 1000] = i;
+
+  comparisons = 0;
+  aisdi::TreeMap<int, int, CountingLess> other(map);
+  aisdi::TreeMap<int, int, CountingLess> assigned = { { 5, 5 } };
+  assigned = map;
+
+  BOOST_CHECK_EQUAL(comparisons, 0u);
+  BOOST_CHECK_EQUAL(other.getSize(), 1000u);
+  BOOST_CHECK_EQUAL(assigned.getSize(), 1000u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenCopiedMap_WhenModifyingIt_ThenItStaysConsistent,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 200; ++i)
+    map[K(i)] = std::to_string(i);
+
+  Map<K> other(map);
+  BOOST_CHECK(other == map);
+  thenCopiedObjectsCountWas<K>(200);
+
+  for (int i = 0; i < 200; i += 3)
+    other.remove(K(i));
+  for (int i = 200; i < 300; ++i)
+    other[K(i)] = std::to_string(i);
+
+  std::size_t count = 0;
+  int previous = -1;
+  for (auto it = other.begin(); it != other.end(); ++it, ++count)
+  {
+    const int key = int(it->first);
+    BOOST_CHECK_GT(key, previous);
+    BOOST_CHECK(key >= 200 || key % 3 != 0);
+    previous = key;
+  }
+  BOOST_CHECK_EQUAL(count, other.getSize());
+  BOOST_CHECK_EQUAL(map.getSize(), 200u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSortedRange_WhenBuildingMap_ThenAllItemsAreAdded,
+                              K,
+                              TestedKeyTypes)
+{
+  std::vector<std::pair<K, std::string>> items;
+  for (int i = 0; i < 100; ++i)
+    items.emplace_back(K(i * 2), std::to_string(i));
+
+  auto map = Map<K>::from_sorted(items.begin(), items.end());
+
+  BOOST_CHECK_EQUAL(map.getSize(), 100u);
+  auto it = map.begin();
+  for (const auto& item : items)
+  {
+    BOOST_REQUIRE(it != map.end());
+    BOOST_CHECK_EQUAL(it->first, item.first);
+    BOOST_CHECK_EQUAL(it->second, item.second);
+    ++it;
+  }
+
+  map[K(51)] = "new";
+  map.remove(K(0));
+  BOOST_CHECK_EQUAL(map.getSize(), 100u);
+  BOOST_CHECK_EQUAL(map.begin()->first, K(2));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSortedRangeWithEqualKeys_WhenAssigning_ThenFirstOnesAreKept,
+                              K,
+                              TestedKeyTypes)
+{
+  {
+    const std::vector<std::pair<K, std::string>> items = {
+      { K(1), "a" }, { K(1), "b" }, { K(2), "c" }, { K(3), "d" }, { K(3), "e" }, { K(3), "f" } };
+    Map<K> map = { { 7, "x" } };
+    map.assign_sorted(items.begin(), items.end());
+
+    thenMapContainsItems(map, { { 1, "a" }, { 2, "c" }, { 3, "d" } });
+  }
+
+  thenDestroyedObjectsCountWas<K>(OperationCountingObject::constructedObjectsCount());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenUnsortedRange_WhenBuildingFromSorted_ThenExceptionIsThrownAndNothingLeaks,
+                              K,
+                              TestedKeyTypes)
+{
+  {
+    const std::vector<std::pair<K, std::string>> items = {
+      { K(1), "a" }, { K(2), "b" }, { K(2), "c" }, { K(5), "d" }, { K(4), "e" }, { K(6), "f" } };
+    BOOST_CHECK_THROW(Map<K>::from_sorted(items.begin(), items.end()), std::invalid_argument);
+
+    Map<K> map = { { 7, "x" } };
+    BOOST_CHECK_THROW(map.assign_sorted(items.rbegin(), items.rend()), std::invalid_argument);
+    thenMapContainsItems(map, { { 7, "x" } });
+
+    map[K(3)] = "y";
+    thenMapContainsItems(map, { { 3, "y" }, { 7, "x" } });
+  }
+
+  thenDestroyedObjectsCountWas<K>(OperationCountingObject::constructedObjectsCount());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenUnsortedRange_WhenAssigning_ThenMapIsSortedAndFirstOfEqualKeysIsKept,
+                              K,
+                              TestedKeyTypes)
+{
+  std::vector<std::pair<K, std::string>> items;
+  for (int i = 0; i < 300; ++i)
+    items.emplace_back(K((i * 7919) % 100), std::to_string(i));
+
+  Map<K> map;
+  map.assign(items.begin(), items.end());
+
+  BOOST_CHECK_EQUAL(map.getSize(), 100u);
+  int previous = -1;
+  for (auto it = map.begin(); it != map.end(); ++it)
+  {
+    const int key = int(it->first);
+    BOOST_CHECK_GT(key, previous);
+    previous = key;
+
+    const auto first = std::find_if(items.begin(), items.end(),
+                                    [&](const std::pair<K, std::string>& item) { return item.first == it->first; });
+    BOOST_CHECK_EQUAL(it->second, first->second);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenSortedRange_WhenBuildingMap_ThenTreeIsBalanced)
+{
+  std::vector<std::pair<int, int>> items;
+  for (int i = 0; i < 1023; ++i)
+    items.emplace_back(i, i);
+
+  auto map = aisdi::TreeMap<int, int, CountingLess>::from_sorted(items.begin(), items.end());
+
+  // Perfect tree of 1023 nodes has 10 levels
+  for (int key : { 0, 511, 1022, 300 })
+  {
+    comparisons = 0;
+    BOOST_CHECK(map.find(key) != map.end());
+    BOOST_CHECK_LE(comparisons, 11u);
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenAskingForRankAndSelect_ThenTheyMatchSortedOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<int, std::string> expected;
+  for (int i = 0; i < 400; ++i)
+  {
+    const int key = (i * 7919) % 997;
+    map[K(key)] = "a";
+    expected[key] = "a";
+    if (i % 3 == 0)
+    {
+      const int removed = (i * 31) % 997;
+      if (expected.erase(removed) != 0)
+        map.remove(K(removed));
+    }
+  }
+
+  BOOST_REQUIRE_EQUAL(map.getSize(), expected.size());
+  std::size_t position = 0;
+  for (const auto& item : expected)
+  {
+    BOOST_CHECK_EQUAL(map.rank(K(item.first)), position);
+    BOOST_CHECK_EQUAL(map.select(position)->first, K(item.first));
+    ++position;
+  }
+  BOOST_CHECK(map.select(expected.size()) == map.end());
+  BOOST_CHECK_EQUAL(map.rank(K(2000)), expected.size());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCountingRange_ThenKeysInHalfOpenRangeAreCounted,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 100; i += 2)
+    map[K(i)] = "a";
+
+  BOOST_CHECK_EQUAL(map.count_range(K(10), K(20)), 5u);
+  BOOST_CHECK_EQUAL(map.count_range(K(11), K(21)), 5u);
+  BOOST_CHECK_EQUAL(map.count_range(K(0), K(1000)), 50u);
+  BOOST_CHECK_EQUAL(map.count_range(K(20), K(10)), 0u);
+  BOOST_CHECK_EQUAL(map.count_range(K(20), K(20)), 0u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIterator_WhenAdvancingByMany_ThenItLandsOnRightElement,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 100; ++i)
+    map[K(i)] = "a";
+
+  auto it = map.begin();
+  it += 37;
+  BOOST_CHECK_EQUAL(it->first, K(37));
+  it -= 10;
+  BOOST_CHECK_EQUAL(it->first, K(27));
+  BOOST_CHECK((it + 73) == map.end());
+  BOOST_CHECK_EQUAL((map.end() - 1)->first, K(99));
+  BOOST_CHECK_EQUAL((map.cend() - 100)->first, K(0));
+  BOOST_CHECK_THROW(it += 74, std::out_of_range);
+  BOOST_CHECK_THROW(it -= 28, std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(GivenManyInsertsAndRemoves_WhenFindingKeys_ThenTreeStaysBalanced)
+{
+  aisdi::TreeMap<int, int, CountingLess> map;
+  for (int i = 0; i < 4000; ++i)
+    map[(i * 7919) % 4093] = i;
+  for (int i = 0; i < 4000; i += 2)
+    map.remove((i * 7919) % 4093);
+
+  // AVL tree of 2000 nodes is at most 15 levels high
+  for (int i = 1; i < 4000; i += 2)
+  {
+    comparisons = 0;
+    map.find((i * 7919) % 4093);
+    BOOST_CHECK_LE(comparisons, 16u);
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenLookingForBounds_ThenNeighbouringElementsAreFound,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 10; i <= 50; i += 10)
+    map[K(i)] = std::to_string(i);
+  const Map<K>& constMap = map;
+
+  BOOST_CHECK_EQUAL(map.lower_bound(K(20))->first, K(20));
+  BOOST_CHECK_EQUAL(map.lower_bound(K(21))->first, K(30));
+  BOOST_CHECK_EQUAL(constMap.lower_bound(K(0))->first, K(10));
+  BOOST_CHECK(map.lower_bound(K(51)) == map.end());
+
+  BOOST_CHECK_EQUAL(map.upper_bound(K(20))->first, K(30));
+  BOOST_CHECK_EQUAL(constMap.upper_bound(K(19))->first, K(20));
+  BOOST_CHECK(map.upper_bound(K(50)) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenAskingForEqualRange_ThenItHoldsMatchingElementOnly,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "a" }, { 3, "b" }, { 5, "c" } };
+  const Map<K>& constMap = map;
+
+  auto found = map.equal_range(K(3));
+  BOOST_CHECK(found.first == map.find(K(3)));
+  BOOST_CHECK(found.second == map.find(K(5)));
+
+  auto missing = constMap.equal_range(K(4));
+  BOOST_CHECK(missing.first == missing.second);
+  BOOST_CHECK(missing.first == constMap.find(K(5)));
+
+  auto last = map.equal_range(K(5));
+  BOOST_CHECK(last.second == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenIteratingRange_ThenKeysInHalfOpenRangeAreVisited,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 100; i += 3)
+    map[K(i)] = "a";
+
+  std::vector<K> keys;
+  for (auto& item : map.range(K(10), K(30)))
+  {
+    item.second = "b";
+    keys.push_back(item.first);
+  }
+
+  const std::vector<K> expected = { K(12), K(15), K(18), K(21), K(24), K(27) };
+  BOOST_CHECK_EQUAL_COLLECTIONS(keys.begin(), keys.end(), expected.begin(), expected.end());
+  BOOST_CHECK_EQUAL(map.valueOf(K(12)), "b");
+  BOOST_CHECK_EQUAL(map.valueOf(K(30)), "a");
+
+  const Map<K>& constMap = map;
+  BOOST_CHECK(constMap.range(K(30), K(10)).empty());
+  BOOST_CHECK(constMap.range(K(13), K(15)).empty());
+  BOOST_CHECK_EQUAL(std::distance(constMap.range(K(0), K(1000)).begin(), constMap.range(K(0), K(1000)).end()), 34);
+}
+
+template <typename K>
+void thenKeysAreInRange(const Map<K>& map, int first, int last, int step)
+{
+  std::vector<K> expected;
+  for (int i = first; i < last; i += step)
+    expected.push_back(K(i));
+
+  std::vector<K> keys;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    keys.push_back(it->first);
+
+  BOOST_CHECK_EQUAL_COLLECTIONS(keys.begin(), keys.end(), expected.begin(), expected.end());
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+  for (std::size_t i = 0; i < expected.size(); ++i)
+    BOOST_CHECK_EQUAL(map.select(i)->first, expected[i]);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenErasingRange_ThenOnlyKeysInRangeAreRemoved,
+                              K,
+                              TestedKeyTypes)
+{
+  {
+    Map<K> map;
+    for (int i = 0; i < 300; ++i)
+      map[K(i)] = std::to_string(i);
+
+    BOOST_CHECK_EQUAL(map.erase_range(K(0), K(100)), 100u);
+    BOOST_CHECK_EQUAL(map.erase_range(K(250), K(1000)), 50u);
+    BOOST_CHECK_EQUAL(map.erase_range(K(120), K(110)), 0u);
+    thenKeysAreInRange(map, 100, 250, 1);
+
+    map[K(50)] = "back";
+    map.remove(K(200));
+    BOOST_CHECK_EQUAL(map.begin()->first, K(50));
+    BOOST_CHECK(map.find(K(200)) == map.end());
+  }
+
+  thenDestroyedObjectsCountWas<K>(OperationCountingObject::constructedObjectsCount());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenSplitting_ThenUpperKeysGoToNewMap,
+                              K,
+                              TestedKeyTypes)
+{
+  {
+    Map<K> upper;
+    {
+      Map<K> map;
+      for (int i = 0; i < 200; i += 2)
+        map[K(i)] = std::to_string(i);
+
+      upper = map.split(K(101));
+      thenKeysAreInRange(map, 0, 101, 2);
+      thenKeysAreInRange(upper, 102, 200, 2);
+
+      map[K(1)] = "a";
+      map.remove(K(0));
+      upper.remove(K(102));
+      BOOST_CHECK_EQUAL(map.select(0)->first, K(1));
+    }
+    // Memory of the split off nodes outlives the map they came from
+    thenKeysAreInRange(upper, 104, 200, 2);
+    upper[K(500)] = "b";
+    BOOST_CHECK_EQUAL(upper.getSize(), 49u);
+  }
+
+  thenDestroyedObjectsCountWas<K>(OperationCountingObject::constructedObjectsCount());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSplitMaps_WhenJoiningThemBack_ThenOriginalMapIsRestored,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 500; ++i)
+    map[K(i)] = std::to_string(i);
+  const Map<K> original(map);
+
+  auto upper = map.split(K(123));
+  auto middle = map.split(K(45));
+  middle.join(upper);
+  BOOST_CHECK(upper.isEmpty());
+  map.join(std::move(middle));
+  BOOST_CHECK(middle.isEmpty());
+
+  BOOST_CHECK(map == original);
+  thenKeysAreInRange(map, 0, 500, 1);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenOverlappingMaps_WhenJoining_ThenExceptionIsThrown,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "a" }, { 5, "b" } };
+  Map<K> other = { { 3, "c" } };
+
+  BOOST_CHECK_THROW(map.join(other), std::invalid_argument);
+  BOOST_CHECK_EQUAL(map.getSize(), 2u);
+  BOOST_CHECK_EQUAL(other.getSize(), 1u);
+
+  Map<K> same = { { 5, "d" }, { 6, "e" } };
+  BOOST_CHECK_THROW(map.join(same), std::invalid_argument);
+
+  map.join(Map<K>());
+  Map<K> empty;
+  empty.join(other);
+  BOOST_CHECK_EQUAL(empty.valueOf(K(3)), "c");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSplitMaps_WhenJoiningThem_ThenAllItemsAreKept,
+                              K,
+                              TestedKeyTypes)
+{
+  {
+    Map<K> first;
+    Map<K> second;
+    for (int i = 0; i < 100; ++i)
+    {
+      first[K(i)] = "a";
+      second[K(i + 100)] = "b";
+    }
+    auto firstUpper = first.split(K(50));
+    auto secondUpper = second.split(K(150));
+
+    // Both maps were split from another one
+    first.join(second);
+    BOOST_CHECK_EQUAL(first.getSize(), 100u);
+    BOOST_CHECK_EQUAL(first.select(49)->first, K(49));
+    BOOST_CHECK_EQUAL(first.select(50)->first, K(100));
+
+    // Only the joined map was split from another one
+    Map<K> fresh = { { 300, "c" } };
+    fresh.join(secondUpper);
+    BOOST_CHECK_EQUAL(fresh.getSize(), 51u);
+    BOOST_CHECK_EQUAL(fresh.begin()->first, K(150));
+
+    firstUpper.remove(K(60));
+    fresh.remove(K(160));
+    BOOST_CHECK_EQUAL(firstUpper.getSize(), 49u);
+  }
+
+  thenDestroyedObjectsCountWas<K>(OperationCountingObject::constructedObjectsCount());
+}
+
+BOOST_AUTO_TEST_CASE(GivenManySplitsAndJoins_WhenFindingKeys_ThenTreeStaysBalanced)
+{
+  aisdi::TreeMap<int, int, CountingLess> map;
+  for (int i = 0; i < 2048; ++i)
+    map[i] = i;
+
+  for (int i = 1; i < 64; ++i)
+  {
+    auto upper = map.split((i * 997) % 2048);
+    if (i % 2 == 0)
+      upper.join(map), map = std::move(upper);
+    else
+      map.join(upper);
+    map.erase_range(4096 + i, 4097 + i);
+  }
+  BOOST_REQUIRE_EQUAL(map.getSize(), 2048u);
+
+  // AVL tree of 2048 nodes is at most 16 levels high
+  for (int i = 0; i < 2048; i += 7)
+  {
+    comparisons = 0;
+    map.find(i);
+    BOOST_CHECK_LE(comparisons, 17u);
+  }
+}
+
+template <typename K>
+Map<K> makeMapOfKeys(int first, int last, int step, const std::string& value)
+{
+  Map<K> map;
+  for (int i = first; i < last; i += step)
+    map[K(i)] = value;
+  return map;
+}
+
+template <typename K>
+void thenMapHasKeysOf(const Map<K>& map, const std::set<int>& keys)
+{
+  BOOST_REQUIRE_EQUAL(map.getSize(), keys.size());
+  std::size_t position = 0;
+  auto it = map.begin();
+  for (int key : keys)
+  {
+    BOOST_CHECK_EQUAL(it->first, K(key));
+    BOOST_CHECK_EQUAL(map.rank(K(key)), position++);
+    ++it;
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapsOfSimilarSize_WhenMerging_ThenUnionIsMadeWithoutCopies,
+                              K,
+                              TestedKeyTypes)
+{
+  {
+    auto map = makeMapOfKeys<K>(0, 600, 2, "mine");
+    auto other = makeMapOfKeys<K>(0, 600, 3, "theirs");
+    OperationCountingObject::resetCounters();
+
+    map.merge(std::move(other));
+
+    std::set<int> expected;
+    for (int i = 0; i < 600; ++i)
+      if (i % 2 == 0 || i % 3 == 0)
+        expected.insert(i);
+    thenMapHasKeysOf(map, expected);
+    BOOST_CHECK(other.isEmpty());
+    BOOST_CHECK_EQUAL(map.valueOf(K(6)), "mine");
+    BOOST_CHECK_EQUAL(map.valueOf(K(3)), "theirs");
+    thenCopiedObjectsCountWas<K>(0);
+
+    map[K(1)] = "new";
+    map.remove(K(0));
+    BOOST_CHECK_EQUAL(map.begin()->first, K(1));
+  }
+
+  thenDestroyedObjectsCountWas<K>(OperationCountingObject::constructedObjectsCount() + 500);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMuchSmallerMap_WhenMerging_ThenItsElementsAreAdded,
+                              K,
+                              TestedKeyTypes)
+{
+  auto map = makeMapOfKeys<K>(1, 1001, 1, "mine");
+  Map<K> other = { { 5, "theirs" }, { 1500, "theirs" }, { 0, "theirs" } };
+
+  map.merge(std::move(other));
+
+  BOOST_CHECK(other.isEmpty());
+  BOOST_CHECK_EQUAL(map.getSize(), 1002u);
+  BOOST_CHECK_EQUAL(map.valueOf(K(5)), "mine");
+  BOOST_CHECK_EQUAL(map.valueOf(K(1500)), "theirs");
+  BOOST_CHECK_EQUAL(map.select(0)->first, K(0));
+  BOOST_CHECK_EQUAL(map.rank(K(1500)), 1001u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMaps_WhenIntersecting_ThenOnlyCommonKeysRemain,
+                              K,
+                              TestedKeyTypes)
+{
+  auto map = makeMapOfKeys<K>(0, 600, 2, "mine");
+  auto similar = makeMapOfKeys<K>(0, 900, 3, "theirs");
+  auto large = makeMapOfKeys<K>(0, 20000, 5, "theirs");
+
+  map.intersect(similar);
+  std::set<int> expected;
+  for (int i = 0; i < 600; i += 6)
+    expected.insert(i);
+  thenMapHasKeysOf(map, expected);
+  BOOST_CHECK_EQUAL(map.valueOf(K(6)), "mine");
+
+  map.intersect(large);
+  expected.clear();
+  for (int i = 0; i < 600; i += 30)
+    expected.insert(i);
+  thenMapHasKeysOf(map, expected);
+
+  map.intersect(map);
+  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+  map.intersect(Map<K>());
+  BOOST_CHECK(map.isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMaps_WhenSubtracting_ThenCommonKeysAreRemoved,
+                              K,
+                              TestedKeyTypes)
+{
+  auto map = makeMapOfKeys<K>(0, 600, 1, "mine");
+  auto similar = makeMapOfKeys<K>(0, 900, 2, "theirs");
+  Map<K> small = { { 1, "x" }, { 7, "y" }, { 2000, "z" } };
+
+  map.subtract(similar);
+  std::set<int> expected;
+  for (int i = 1; i < 600; i += 2)
+    expected.insert(i);
+  thenMapHasKeysOf(map, expected);
+
+  map.subtract(small);
+  expected.erase(1);
+  expected.erase(7);
+  thenMapHasKeysOf(map, expected);
+
+  map.subtract(map);
+  BOOST_CHECK(map.isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(GivenMergedMap_WhenFindingKeys_ThenTreeIsBalanced)
+{
+  aisdi::TreeMap<int, int, CountingLess> map;
+  aisdi::TreeMap<int, int, CountingLess> other;
+  for (int i = 0; i < 1023; ++i)
+    (i % 2 == 0 ? map : other)[i] = i;
+
+  map.merge(std::move(other));
+  BOOST_REQUIRE_EQUAL(map.getSize(), 1023u);
+
+  // Rebuilt perfect tree of 1023 nodes has 10 levels
+  for (int i = 0; i < 1023; i += 11)
+  {
+    comparisons = 0;
+    map.find(i);
+    BOOST_CHECK_LE(comparisons, 11u);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenAscendingKeys_WhenAddingThem_ThenOnlyOneComparisonIsMadePerKey)
+{
+  aisdi::TreeMap<int, int, CountingLess> map;
+  map[0] = 0;
+
+  comparisons = 0;
+  for (int i = 1; i < 1000; ++i)
+    map[i] = i;
+
+  BOOST_CHECK_EQUAL(comparisons, 999u);
+  BOOST_CHECK_EQUAL(map.getSize(), 1000u);
+  BOOST_CHECK_EQUAL((--map.end())->first, 999);
+}
+
+BOOST_AUTO_TEST_CASE(GivenKeysInRandomOrder_WhenAddingThem_ThenCompareIsCalledOncePerLevel)
+{
+  aisdi::TreeMap<int, int, CountingLess> map;
+  map[5000] = 0;
+  map[0] = 0;
+
+  // Looking up a missing key walks the same path to a leaf as adding it
+  for (int i = 1; i < 4000; ++i)
+  {
+    const int key = 1 + (i * 7919) % 4093;
+    comparisons = 0;
+    map.find(key);
+    const std::size_t lookup = comparisons;
+
+    comparisons = 0;
+    map[key] = i;
+    BOOST_CHECK_EQUAL(comparisons, lookup);
+  }
+  BOOST_CHECK_EQUAL(map.getSize(), 4001u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenHintAtEnd_WhenInsertingGreaterKeys_ThenTheyAreAppended,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 300; ++i)
+  {
+    auto it = map.insert(map.end(), { K(i), std::to_string(i) });
+    BOOST_CHECK_EQUAL(it->first, K(i));
+  }
+
+  thenKeysAreInRange(map, 0, 300, 1);
+  BOOST_CHECK_EQUAL(map.valueOf(K(299)), "299");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenHint_WhenInsertingKey_ThenItLandsInOrderWhetherHintIsRightOrNot,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (int i = 0; i < 100; i += 10)
+    map[K(i)] = "a";
+
+  auto right = map.insert(map.find(K(50)), { K(45), "b" });
+  auto wrong = map.insert(map.find(K(10)), { K(75), "c" });
+  auto first = map.insert(map.begin(), { K(0), "d" });
+  auto last = map.insert(map.end(), { K(55), "e" });
+
+  BOOST_CHECK_EQUAL(right->second, "b");
+  BOOST_CHECK_EQUAL(wrong->second, "c");
+  BOOST_CHECK_EQUAL(first->second, "a");
+  BOOST_CHECK_EQUAL(last->second, "e");
+  BOOST_CHECK_EQUAL(map.getSize(), 13u);
+
+  int previous = -1;
+  for (auto it = map.begin(); it != map.end(); ++it)
+  {
+    BOOST_CHECK_GT(int(it->first), previous);
+    previous = int(it->first);
+  }
+  BOOST_CHECK_EQUAL(map.rank(K(75)), 10u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenHintWithExistingKey_WhenInserting_ThenExistingElementIsReturned,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "a" }, { 2, "b" }, { 3, "c" } };
+
+  BOOST_CHECK_EQUAL(map.insert(map.find(K(2)), { K(2), "x" })->second, "b");
+  BOOST_CHECK_EQUAL(map.insert(map.find(K(3)), { K(2), "x" })->second, "b");
+  BOOST_CHECK_EQUAL(map.insert(map.end(), { K(3), "x" })->second, "c");
+  BOOST_CHECK_EQUAL(map.insert(map.begin(), { K(3), "x" })->second, "c");
+  BOOST_CHECK_EQUAL(map.getSize(), 3u);
+
+  Map<K> other;
+  BOOST_CHECK_THROW(map.insert(other.end(), { K(4), "x" }), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapChangedInManyWays_WhenDecrementingEnd_ThenLargestElementIsReached,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::set<int> keys;
+  auto thenLargestIs = [&](const Map<K>& tested) {
+    BOOST_REQUIRE(!keys.empty());
+    BOOST_CHECK_EQUAL((--tested.end())->first, K(*keys.rbegin()));
+  };
+
+  for (int i = 0; i < 200; ++i)
+  {
+    map[K((i * 37) % 250)] = "a";
+    keys.insert((i * 37) % 250);
+  }
+  thenLargestIs(map);
+
+  for (int i = 0; i < 30; ++i)
+  {
+    map.remove(--map.end());
+    keys.erase(std::prev(keys.end()));
+    thenLargestIs(map);
+  }
+
+  auto upper = map.split(K(100));
+  std::set<int> upperKeys(keys.lower_bound(100), keys.end());
+  keys.erase(keys.lower_bound(100), keys.end());
+  thenLargestIs(map);
+  map[K(99)] = "b";
+  keys.insert(99);
+  thenLargestIs(map);
+
+  map.join(upper);
+  keys.insert(upperKeys.begin(), upperKeys.end());
+  thenLargestIs(map);
+  BOOST_CHECK(upper.begin() == upper.end());
+
+  map.erase_range(K(150), K(1000));
+  keys.erase(keys.lower_bound(150), keys.end());
+  thenLargestIs(map);
+
+  auto other = makeMapOfKeys<K>(0, 400, 7, "c");
+  map.merge(std::move(other));
+  for (int i = 0; i < 400; i += 7)
+    keys.insert(i);
+  thenLargestIs(map);
+
+  Map<K> copy(map);
+  thenLargestIs(copy);
+  map.subtract(makeMapOfKeys<K>(300, 400, 1, "d"));
+  keys.erase(keys.lower_bound(300), keys.end());
+  thenLargestIs(map);
+  map[K(1000)] = "e";
+  keys.insert(1000);
+  thenLargestIs(map);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMapWithCustomAllocator_WhenAddingItems_ThenAllMemoryComesFromIt)
+{
+  using Allocator = CountingAllocator<std::pair<const int, std::string>>;
+  AllocationStats stats;
+  {
+    aisdi::TreeMap<int, std::string, std::less<int>, Allocator> map{Allocator(&stats)};
+    for (int i = 0; i < 100; ++i)
+      map[i] = std::to_string(i);
+
+    BOOST_CHECK_GT(stats.allocations, 0u);
+
+    aisdi::TreeMap<int, std::string, std::less<int>, Allocator> copy(map);
+    aisdi::TreeMap<int, std::string, std::less<int>, Allocator> moved(std::move(map));
+    copy.remove(42);
+
+    BOOST_CHECK(copy.get_allocator() == moved.get_allocator());
+    BOOST_CHECK_EQUAL(copy.getSize(), 99);
+    BOOST_CHECK_EQUAL(moved.valueOf(42), "42");
+  }
+  BOOST_CHECK_EQUAL(stats.liveBytes, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMapsWithDifferentAllocators_WhenJoining_ThenElementsMoveToThisMapsMemory)
+{
+  using Allocator = CountingAllocator<std::pair<const int, std::string>>;
+  AllocationStats stats;
+  AllocationStats otherStats;
+  {
+    aisdi::TreeMap<int, std::string, std::less<int>, Allocator> map{Allocator(&stats)};
+    aisdi::TreeMap<int, std::string, std::less<int>, Allocator> other{Allocator(&otherStats)};
+    for (int i = 0; i < 100; ++i)
+      map[i] = std::to_string(i);
+    for (int i = 100; i < 200; ++i)
+      other[i] = std::to_string(i);
+
+    map.join(other);
+    BOOST_CHECK(other.isEmpty());
+    BOOST_CHECK_EQUAL(map.getSize(), 200u);
+    BOOST_CHECK_EQUAL(map.valueOf(150), "150");
+
+    auto upper = map.split(50);
+    map.erase_range(10, 20);
+    BOOST_CHECK_EQUAL(upper.getSize(), 150u);
+    BOOST_CHECK_EQUAL(map.getSize(), 40u);
+  }
+  BOOST_CHECK_EQUAL(stats.liveBytes, 0u);
+  BOOST_CHECK_EQUAL(otherStats.liveBytes, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMapsKeepingOnlyUpperSplit_WhenRepeatingIt_ThenMemoryStaysBounded)
+{
+  using Allocator = CountingAllocator<std::pair<const int, int>>;
+  using StringAllocator = CountingAllocator<std::pair<const int, std::string>>;
+  AllocationStats stats;
+  AllocationStats stringStats;
+  {
+    aisdi::TreeMap<int, int, std::less<int>, Allocator> map{Allocator(&stats)};
+    aisdi::TreeMap<int, std::string, std::less<int>, StringAllocator> strings{StringAllocator(&stringStats)};
+    std::size_t liveBytes = 0;
+    std::size_t stringLiveBytes = 0;
+
+    // Sliding window - newest 1000 keys are kept
+    for (int cycle = 0; cycle < 100; ++cycle)
+    {
+      for (int i = cycle * 1000; i < (cycle + 1) * 1000; ++i)
+      {
+        map[i] = i;
+        strings[i] = "x";
+      }
+      map = map.split(cycle * 1000);
+      strings = strings.split(cycle * 1000);
+      BOOST_REQUIRE_EQUAL(map.getSize(), 1000u);
+
+      if (cycle == 10)
+      {
+        liveBytes = stats.liveBytes;
+        stringLiveBytes = stringStats.liveBytes;
+      }
+    }
+    BOOST_CHECK_EQUAL(stats.liveBytes, liveBytes);
+    BOOST_CHECK_EQUAL(stringStats.liveBytes, stringLiveBytes);
+  }
+  BOOST_CHECK_EQUAL(stats.liveBytes, 0u);
+  BOOST_CHECK_EQUAL(stringStats.liveBytes, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenLargeMap_WhenSplittingOffFewKeysAndDestroyingIt_ThenMostOfItsMemoryIsGivenBack)
+{
+  using Allocator = CountingAllocator<std::pair<const int, std::string>>;
+  AllocationStats stats;
+  {
+    aisdi::TreeMap<int, std::string, std::less<int>, Allocator> upper{Allocator(&stats)};
+    std::size_t fullBytes = 0;
+    {
+      aisdi::TreeMap<int, std::string, std::less<int>, Allocator> map{Allocator(&stats)};
+      for (int i = 0; i < 100000; ++i)
+        map[i] = std::to_string(i);
+      fullBytes = stats.liveBytes;
+      upper = map.split(99990);
+
+      auto rest = map.split(10);
+      BOOST_CHECK_EQUAL(map.getSize(), 10u);
+      BOOST_CHECK_EQUAL(rest.getSize(), 99980u);
+      BOOST_CHECK_EQUAL(rest.valueOf(50000), "50000");
+      BOOST_CHECK_EQUAL(stats.liveBytes, fullBytes);
+    }
+    // Only slabs still holding the split off nodes are kept
+    BOOST_REQUIRE_EQUAL(upper.getSize(), 10u);
+    BOOST_CHECK_EQUAL(upper.valueOf(99995), "99995");
+    BOOST_CHECK_LT(stats.liveBytes, fullBytes / 10);
+
+    upper[100000] = "100000";
+    for (int i = 99990; i < 100000; ++i)
+      upper.remove(i);
+    BOOST_CHECK_EQUAL(upper.getSize(), 1u);
+  }
+  BOOST_CHECK_EQUAL(stats.liveBytes, 0u);
+}
+
 // ConstIterator is tested via Iterator methods.
 // If Iterator methods are to be changed, then new ConstIterator tests are required.
 